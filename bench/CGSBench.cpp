@@ -0,0 +1,219 @@
+/*	Copyright (c) 2015-2016 William Kappler
+
+	Permission to use, copy, modify, and/or distribute this software for any
+	purpose with or without fee is hereby granted, provided that the above
+	copyright notice and this permission notice appear in all copies.
+
+	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+	REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+	AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+	INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+	LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+	OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+	PERFORMANCE OF THIS SOFTWARE. */
+
+#include "CGSRadixSort.h"
+#include "CGSStreamUtility.h"
+
+#include <stdio.h>
+#include <chrono>
+#include <map>
+#include <random>
+#include <vector>
+
+// Stands in for CGSRenderOperation, with the same members, so the containers
+// move as much data as the real queue does.
+struct Operation
+{
+	void* mesh;
+	bool pullBackbuffer;
+	uint8_t instanceDataSize;
+	uint32_t instanceDataOffset;
+	uint16_t region[ 4 ];
+	uint8_t renderClass;
+};
+
+struct Command
+{
+	uint64_t key;
+	Operation operation;
+};
+
+// Keeps the optimizer from dropping the work being timed.
+volatile uintptr_t sink;
+
+// Runs _work _repeats times and returns the mean in nanoseconds per item.
+template< typename Work >
+double timeWork( const size_t& _items, const size_t& _repeats, Work _work )
+{
+	auto start = std::chrono::steady_clock::now( );
+
+	for( size_t i = 0; i < _repeats; ++i )
+	{
+		_work( );
+	}
+
+	std::chrono::duration< double, std::nano > elapsed = std::chrono::steady_clock::now( ) - start;
+	return elapsed.count( ) / ( (double)_items * _repeats );
+}
+
+// Old path: one frame of a stage kept in a multimap keyed on the ordering,
+// inserted into and then iterated in order. New path: the same operations
+// appended to the command buffer with a full sort key, radix sorted and then
+// iterated. Both containers are reused across frames, as render( ) does.
+void benchmarkSort( const size_t& _count )
+{
+	std::mt19937 random( 1 );
+	std::uniform_int_distribution< int > layers( 0, 63 );
+	std::uniform_int_distribution< uint32_t > state( 0, ( 1 << 30 ) - 1 );
+
+	std::vector< float > orderings( _count );
+	std::vector< uint32_t > states( _count );
+	Operation operation = { };
+
+	for( size_t i = 0; i < _count; ++i )
+	{
+		orderings[ i ] = (float)layers( random );
+		states[ i ] = state( random );
+	}
+
+	size_t repeats = 1 + 2000000 / _count;
+
+	std::multimap< float, Operation > queue;
+	double multimapTime = timeWork( _count, repeats, [ & ]( )
+	{
+		queue.clear( );
+
+		for( size_t i = 0; i < _count; ++i )
+		{
+			operation.mesh = (void*)(uintptr_t)states[ i ];
+			queue.insert( std::make_pair( orderings[ i ], operation ) );
+		}
+
+		uintptr_t sum = 0;
+
+		for( auto i = queue.begin( ); i != queue.end( ); ++i )
+		{
+			sum += (uintptr_t)i->second.mesh;
+		}
+
+		sink = sum;
+	} );
+
+	std::vector< Command > commands;
+	std::vector< Command > sortBuffer;
+	double radixTime = timeWork( _count, repeats, [ & ]( )
+	{
+		commands.clear( );
+
+		for( size_t i = 0; i < _count; ++i )
+		{
+			operation.mesh = (void*)(uintptr_t)states[ i ];
+			commands.push_back( Command {
+					( (uint64_t)_orderingToKey( orderings[ i ] ) << 30 ) | states[ i ],
+					operation } );
+		}
+
+		radixSortByKey( commands, sortBuffer );
+
+		uintptr_t sum = 0;
+
+		for( auto i = commands.begin( ); i != commands.end( ); ++i )
+		{
+			sum += (uintptr_t)i->operation.mesh;
+		}
+
+		sink = sum;
+	} );
+
+	printf( "sort %8zu operations: multimap %7.1f ns/op, radix %7.1f ns/op, %5.2fx\n",
+			_count, multimapTime, radixTime, multimapTime / radixTime );
+}
+
+// A sprite-like vertex: a vec3 position, a vec2 UV and an 8-bit RGBA color.
+const size_t VERTEX_STRIDE = 24;
+const size_t UV_OFFSET = 12;
+
+// The per-value writeToA( ) path: CGSMesh checks the open attribute, finds the
+// value's place in the stream with a divide, copies it and advances, all in
+// an out-of-line call per value.
+struct PerValueWriter
+{
+	uint8_t* stream;
+	size_t length;
+	size_t position;
+	uint32_t type;
+
+	__attribute__(( noinline )) void write( const float& _value, const uint32_t& _type )
+	{
+		if( _type != type || position >= length * 2 )
+		{
+			return;
+		}
+
+		memcpy( stream + streamValueOffset( position, UV_OFFSET, VERTEX_STRIDE, 2, sizeof( float ) ),
+				&_value,
+				sizeof( float ) );
+		++position;
+	}
+};
+
+// Writes the UVs of _vertices vertices into an interleaved stream, once with
+// a writeToA( ) call per value and once with the bulk overload's loop.
+void benchmarkStreamWrites( const size_t& _vertices )
+{
+	std::vector< float > uvs( _vertices * 2 );
+	for( size_t i = 0; i < uvs.size( ); ++i )
+	{
+		uvs[ i ] = (float)i;
+	}
+
+	std::vector< uint8_t > stream( _vertices * VERTEX_STRIDE );
+	size_t repeats = 1 + 20000000 / uvs.size( );
+
+	PerValueWriter writer = { stream.data( ), _vertices, 0, 1 };
+	double perValueTime = timeWork( uvs.size( ), repeats, [ & ]( )
+	{
+		writer.position = 0;
+
+		for( size_t i = 0; i < uvs.size( ); ++i )
+		{
+			writer.write( uvs[ i ], 1 );
+		}
+
+		sink = stream[ UV_OFFSET ];
+	} );
+
+	double bulkTime = timeWork( uvs.size( ), repeats, [ & ]( )
+	{
+		writeStreamValues< float, storeStreamValue< float > >(
+				stream.data( ) + UV_OFFSET,
+				uvs.data( ),
+				uvs.size( ),
+				0,
+				0,
+				2,
+				sizeof( float ),
+				VERTEX_STRIDE - 2 * sizeof( float ) );
+
+		sink = stream[ UV_OFFSET ];
+	} );
+
+	printf( "write %7zu vertexes: per value %5.2f ns/value, bulk %5.2f ns/value, %5.2fx\n",
+			_vertices, perValueTime, bulkTime, perValueTime / bulkTime );
+}
+
+int main( )
+{
+	for( size_t count = 100; count <= 1000000; count *= 10 )
+	{
+		benchmarkSort( count );
+	}
+
+	for( size_t count = 100; count <= 1000000; count *= 10 )
+	{
+		benchmarkStreamWrites( count );
+	}
+
+	return 0;
+}
@@ -0,0 +1,341 @@
+/*	Copyright (c) 2015-2016 William Kappler
+
+	Permission to use, copy, modify, and/or distribute this software for any
+	purpose with or without fee is hereby granted, provided that the above
+	copyright notice and this permission notice appear in all copies.
+
+	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+	REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+	AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+	INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+	LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+	OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+	PERFORMANCE OF THIS SOFTWARE. */
+
+#include "CGSOcclusionPlan.h"
+#include "CGSStreamUtility.h"
+
+#include <stdio.h>
+#include <random>
+#include <vector>
+
+// Checks of the GL-free CGS internals, run by ctest. Each failure is printed,
+// and the exit status is the number of failures.
+int failures = 0;
+
+void check( const bool& _passed, const char* const& _description )
+{
+	if( !_passed )
+	{
+		printf( "FAILED: %s\n", _description );
+		++failures;
+	}
+}
+
+// The bulk writeToA( ) overloads must leave the stream exactly as a
+// writeToA( ) call per value would, including when starting partway through
+// a vertex and when reading from a strided source.
+void checkStreamWrites( )
+{
+	// Vertexes of a 4-byte attribute, then a 3-float attribute, then 4 bytes.
+	const size_t vertices = 7;
+	const size_t stride = 20;
+	const size_t offset = 4;
+	const size_t elements = 3;
+
+	// Every other float of the source is written.
+	std::vector< float > source( vertices * elements * 2 );
+	for( size_t i = 0; i < source.size( ); ++i )
+	{
+		source[ i ] = (float)i + 0.5f;
+	}
+
+	for( size_t first = 0; first < elements * 2; ++first )
+	{
+		size_t count = vertices * elements - first;
+		std::vector< uint8_t > perValue( vertices * stride, 0xAB );
+		std::vector< uint8_t > bulk( perValue );
+
+		for( size_t i = 0; i < count; ++i )
+		{
+			storeStreamValue( perValue.data( ) + streamValueOffset( first + i, offset, stride, elements, sizeof( float ) ),
+					source[ i * 2 ] );
+		}
+
+		writeStreamValues< float, storeStreamValue< float > >(
+				bulk.data( ) + streamValueOffset( first, offset, stride, elements, sizeof( float ) ),
+				source.data( ),
+				count,
+				2 * sizeof( float ),
+				first,
+				elements,
+				sizeof( float ),
+				stride - elements * sizeof( float ) );
+
+		check( perValue == bulk, "bulk stream writes match per-value writes" );
+	}
+}
+
+// Writes within CGSStreamDirtyRanges::MERGE_GAP bytes of each other upload
+// as one range, past MAX_RANGES ranges the closest two merge, and past half
+// the stream the whole of it is uploaded instead.
+void checkDirtyRanges( )
+{
+	const size_t gap = CGSStreamDirtyRanges::MERGE_GAP;
+	const size_t maxRanges = CGSStreamDirtyRanges::MAX_RANGES;
+
+	CGSStreamDirtyRanges ranges;
+	ranges.add( 0, 10 );
+	ranges.add( 10 + gap, 20 + gap );
+	check( ranges.getRanges( ).size( ) == 1
+			&& ranges.getRanges( )[ 0 ] == CGSStreamDirtyRanges::Range( 0, 20 + gap ),
+			"dirty ranges exactly the merge gap apart are merged" );
+
+	ranges.clear( );
+	ranges.add( 10 + gap, 20 + gap );
+	ranges.add( 0, 10 );
+	check( ranges.getRanges( ).size( ) == 1
+			&& ranges.getRanges( )[ 0 ] == CGSStreamDirtyRanges::Range( 0, 20 + gap ),
+			"dirty ranges exactly the merge gap apart are merged in either order" );
+
+	ranges.clear( );
+	ranges.add( 0, 10 );
+	ranges.add( 11 + gap, 20 + gap );
+	check( ranges.getRanges( ).size( ) == 2, "dirty ranges past the merge gap are kept apart" );
+
+	// Out of order, and bridging the two ranges already there.
+	ranges.add( 5, 11 );
+	ranges.add( 100, 110 );
+	check( ranges.getRanges( ).size( ) == 1
+			&& ranges.getRanges( )[ 0 ] == CGSStreamDirtyRanges::Range( 0, 20 + gap ),
+			"a dirty range bridging two others merges all three" );
+
+	// Past the maximum, the two closest ranges merge, and the rest are kept.
+	ranges.clear( );
+	for( size_t i = maxRanges; i > 0; --i )
+	{
+		ranges.add( i * gap * 8, i * gap * 8 + 1 );
+	}
+	check( ranges.getRanges( ).size( ) == maxRanges, "up to the maximum, dirty ranges are kept apart" );
+
+	ranges.add( gap * 82, gap * 82 + 1 );
+	check( ranges.getRanges( ).size( ) == maxRanges
+			&& ranges.getRanges( )[ 8 ] == CGSStreamDirtyRanges::Range( gap * 72, gap * 72 + 1 )
+			&& ranges.getRanges( )[ 9 ] == CGSStreamDirtyRanges::Range( gap * 80, gap * 82 + 1 )
+			&& ranges.getRanges( )[ 10 ] == CGSStreamDirtyRanges::Range( gap * 88, gap * 88 + 1 )
+			&& ranges.getByteCount( ) == gap * 2 + 1 + maxRanges - 1,
+			"past the maximum, only the closest dirty ranges merge" );
+
+	// 1% of the vertexes of a full stream of 24-byte vertexes move, scattered
+	// over it. Only about 1% of it may be uploaded.
+	const size_t stride = 24;
+	const size_t vertices = 65535;
+	const size_t stream = vertices * stride;
+	std::mt19937 random( 1 );
+	std::uniform_int_distribution< size_t > vertex( 0, vertices - 1 );
+
+	ranges.clear( );
+	for( size_t i = 0; i < vertices / 100; ++i )
+	{
+		size_t moved = vertex( random );
+		ranges.add( moved * stride, ( moved + 1 ) * stride );
+	}
+	check( ranges.getByteCount( ) * 100 <= stream * 2 && !ranges.coversMostOf( stream ),
+			"scattered writes to 1% of a stream upload about 1% of it" );
+
+	ranges.clear( );
+	ranges.add( 0, 50 );
+	check( !ranges.coversMostOf( 100 ), "half the stream dirty uploads ranges" );
+	ranges.add( 50, 51 );
+	check( ranges.coversMostOf( 100 ), "over half the stream dirty uploads all of it" );
+
+	ranges.clear( );
+	ranges.add( 0, 10 );
+	ranges.add( 1000, 1010 );
+	ranges.clip( 1005 );
+	check( ranges.getRanges( ).size( ) == 2 && ranges.getRanges( )[ 1 ].second == 1005,
+			"shortening the stream clips the last dirty range" );
+	ranges.clip( 1000 );
+	check( ranges.getRanges( ).size( ) == 1, "shortening the stream drops dirty ranges past its end" );
+}
+
+// Resizing a stream doubles its capacity, unless more is asked for, but never
+// past UINT16_MAX vertexes.
+void checkCapacityGrowth( )
+{
+	check( growStreamCapacity( 100, 101 ) == 200, "stream capacity doubles" );
+	check( growStreamCapacity( 100, 300 ) == 300, "stream capacity grows to a length past double" );
+	check( growStreamCapacity( 0, 1 ) == 1, "an empty stream grows to the length" );
+	check( growStreamCapacity( 40000, 40001 ) == UINT16_MAX, "doubled stream capacity is capped at UINT16_MAX" );
+	check( growStreamCapacity( 40000, UINT16_MAX ) == UINT16_MAX, "stream capacity reaches UINT16_MAX" );
+	check( growStreamCapacity( UINT16_MAX, UINT16_MAX ) == UINT16_MAX,
+			"stream capacity at UINT16_MAX does not grow" );
+
+	// From one vertex, capacity reaches the cap in 16 steps without passing it.
+	uint32_t capacity = 1;
+	size_t steps = 0;
+	while( capacity < UINT16_MAX )
+	{
+		uint32_t grown = growStreamCapacity( capacity, (uint16_t)( capacity + 1 ) );
+		check( grown > capacity && grown <= UINT16_MAX, "stream capacity grows within UINT16_MAX" );
+		capacity = grown;
+		++steps;
+	}
+	check( steps == 16, "stream capacity doubles up to UINT16_MAX" );
+}
+
+// One occlusion tested mesh, rendered as GraphicsSystem::render( ) does:
+// frames are skipped while nothing is damaged, and frames redrawing only part
+// of the screen do not test the mesh. The occluder, when covering the mesh,
+// hides it whether or not the mesh is drawn.
+struct OcclusionModel
+{
+	bool damageTracking;
+	bool alwaysWhole; // As when a stage renders to a target
+	bool covered;
+	bool onScreen;
+
+	uint64_t frame;
+	bool damaged;
+	bool damageWhole;
+	uint64_t queryFrame;
+	bool queryPassed;
+	uint64_t conditionalFrame;
+
+	OcclusionModel( const bool& _damageTracking, const bool& _alwaysWhole )
+	{
+		damageTracking = _damageTracking;
+		alwaysWhole = _alwaysWhole;
+		covered = false;
+		onScreen = false;
+		frame = 0;
+		damaged = true;
+		damageWhole = true;
+		queryFrame = UINT64_MAX;
+		queryPassed = false;
+		conditionalFrame = UINT64_MAX;
+	}
+
+	// Damage from the application, over the whole screen or over the mesh.
+	void damage( const bool& _whole )
+	{
+		damageWhole = ( damaged && damageWhole ) || _whole;
+		damaged = true;
+	}
+
+	// Returns false if the frame was skipped.
+	bool render( )
+	{
+		if( damageTracking && !damaged )
+		{
+			return false;
+		}
+
+		bool whole = !damageTracking || damageWhole || alwaysWhole;
+		damaged = false;
+		damageWhole = false;
+
+		if( whole )
+		{
+			CGSOcclusionPlan plan = planOcclusionDraw(
+					frame && queryFrame == frame - 1,
+					frame && conditionalFrame == frame - 1,
+					damageTracking );
+			bool drawn = !plan.conditional || queryPassed;
+
+			if( plan.conditional )
+			{
+				conditionalFrame = frame;
+			}
+
+			if( plan.damageNextFrame )
+			{
+				damage( false );
+			}
+
+			queryFrame = frame;
+			queryPassed = !covered;
+			onScreen = drawn && !covered;
+		}
+		else
+		{
+			// The damage here is always over the mesh, which is drawn untested.
+			onScreen = !covered;
+		}
+
+		++frame;
+		return true;
+	}
+
+	// Renders until a frame is skipped, returning how many were rendered, or
+	// _limit if none was.
+	size_t renderUntilIdle( const size_t& _limit )
+	{
+		size_t frames = 0;
+
+		while( frames < _limit && render( ) )
+		{
+			++frames;
+		}
+
+		return frames;
+	}
+};
+
+// A mesh hidden by an occluder must reappear once the occluder moves away,
+// even though the frame which draws it conditionally still hides it, and
+// however the following frames are rendered.
+void checkOcclusion( )
+{
+	for( uint8_t alwaysWhole = 0; alwaysWhole < 2; ++alwaysWhole )
+	{
+		OcclusionModel model( true, alwaysWhole );
+		model.covered = true;
+		model.render( );
+		check( !model.onScreen, "an occlusion tested mesh is hidden while covered" );
+
+		// The occluder moves away, damaging the whole screen. The next frame
+		// draws the mesh conditionally on the query which found it covered.
+		model.covered = false;
+		model.damage( true );
+		model.render( );
+		check( !model.onScreen, "an uncovered mesh takes a frame to reappear" );
+
+		check( model.renderUntilIdle( 10 ) < 10, "occlusion testing lets damage tracking go idle" );
+		check( model.onScreen, "an uncovered mesh reappears with damage tracking" );
+
+		// Covered for good, frames still stop.
+		model.covered = true;
+		model.damage( true );
+		check( model.renderUntilIdle( 10 ) < 10, "a covered mesh lets damage tracking go idle" );
+		check( !model.onScreen, "a covered mesh stays hidden" );
+	}
+
+	// Without damage tracking, every frame is rendered and tested, and no
+	// damage is added.
+	CGSOcclusionPlan plan = planOcclusionDraw( true, true, false );
+	check( plan.conditional && !plan.damageNextFrame, "without damage tracking, meshes are always tested" );
+
+	OcclusionModel model( false, false );
+	model.covered = true;
+	model.render( );
+	model.covered = false;
+	model.render( );
+	model.render( );
+	check( model.onScreen, "an uncovered mesh reappears without damage tracking" );
+}
+
+int main( )
+{
+	checkStreamWrites( );
+	checkDirtyRanges( );
+	checkCapacityGrowth( );
+	checkOcclusion( );
+
+	if( !failures )
+	{
+		printf( "All checks passed.\n" );
+	}
+
+	return failures;
+}
@@ -0,0 +1,117 @@
+/*	Copyright (c) 2015-2016 William Kappler
+
+	Permission to use, copy, modify, and/or distribute this software for any
+	purpose with or without fee is hereby granted, provided that the above
+	copyright notice and this permission notice appear in all copies.
+
+	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+	REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+	AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+	INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+	LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+	OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+	PERFORMANCE OF THIS SOFTWARE. */
+
+// GPU time of backbuffer pulls under each BackbufferStrategy. One stage draws
+// a fixed number of full screen compositor meshes, each pulling the backbuffer
+// and reading it back at its own texel, which both strategies define. Run it
+// once per strategy, from the directory holding glsl/:
+//   CGSPullBench copy [pulls] [frames]
+//   CGSPullBench barrier [pulls] [frames]
+#include "CGS.h"
+#include "CGSMesh.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main( int argc, char* argv[ ] )
+{
+	if( argc < 2 || ( strcmp( argv[ 1 ], "copy" ) && strcmp( argv[ 1 ], "barrier" ) ) )
+	{
+		printf( "Usage: %s copy|barrier [pulls] [frames]\n", argv[ 0 ] );
+		return 1;
+	}
+
+	BackbufferStrategy strategy = strcmp( argv[ 1 ], "copy" )
+			? BackbufferStrategy::TEXTURE_BARRIER : BackbufferStrategy::COPY;
+	size_t pulls = argc > 2 ? strtoul( argv[ 2 ], NULL, 10 ) : 16;
+	size_t frames = argc > 3 ? strtoul( argv[ 3 ], NULL, 10 ) : 600;
+
+	// Frames before these are not counted, so that the first uploads, program
+	// links and the driver settling do not skew the result.
+	const size_t warmupFrames = 60;
+
+	GraphicsSystem graphics;
+
+	if( !graphics.init( 1280, 720, "CGSPullBench", GraphicsSystem::DEFAULT_SHADER_PATH, strategy ) )
+	{
+		return 1;
+	}
+
+	if( graphics.getBackbufferStrategy( ) != strategy )
+	{
+		printf( "TEXTURE_BARRIER is not supported here; nothing to compare.\n" );
+		return 1;
+	}
+
+	// Frames must not wait for the display, or they all take the refresh.
+	graphics.setPresentMode( PresentMode::IMMEDIATE );
+
+	CGSRenderStage* stage = graphics.getRenderStage( 0 );
+	stage->setRetained( true );
+
+	for( size_t i = 0; i < pulls; ++i )
+	{
+		// Separate meshes, so that no two operations become one instanced draw.
+		CGSMesh* mesh = graphics.createCompositorMesh( "pull" );
+
+		if( !mesh )
+		{
+			return 1;
+		}
+
+		mesh->programUniform1i( "backbuffer", CGSRenderStage::DEFAULT_BACK_BUFFER_TEXTURE_UNIT );
+		stage->insertOperation( (CGSRenderOrderingType)i, mesh, true );
+	}
+
+	double total = 0.0;
+	double fastest = 0.0;
+	size_t counted = 0;
+	bool quit = false;
+
+	for( size_t frame = 0; frame < warmupFrames + frames && !quit; ++frame )
+	{
+		SDL_Event event;
+
+		while( SDL_PollEvent( &event ) )
+		{
+			quit = quit || event.type == SDL_QUIT;
+		}
+
+		graphics.render( );
+
+		// The time is of the latest frame the GPU finished, a frame or two
+		// behind, which is the same for both strategies.
+		double time = graphics.getGPUFrameTime( );
+
+		if( frame >= warmupFrames && time > 0.0 )
+		{
+			total += time;
+			fastest = counted ? U::min( fastest, time ) : time;
+			++counted;
+		}
+	}
+
+	if( !counted )
+	{
+		printf( "No GPU frame time was measured.\n" );
+		return 1;
+	}
+
+	printf( "%s, %zu pulls a frame at 1280x720: mean %.3f ms, fastest %.3f ms over %zu frames\n",
+			strategy == BackbufferStrategy::COPY ? "COPY" : "TEXTURE_BARRIER",
+			pulls, total / counted, fastest, counted );
+
+	return 0;
+}
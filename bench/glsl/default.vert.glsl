@@ -0,0 +1,7 @@
+#version 330 core
+// GraphicsSystem::init( ) needs a default shader pair to load.
+layout( location = 0 ) in vec4 position;
+void main( )
+{
+	gl_Position = position;
+}
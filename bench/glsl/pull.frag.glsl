@@ -0,0 +1,11 @@
+#version 330 core
+// Reads the backbuffer only at the fragment's own texel, which both
+// backbuffer strategies define. The result changes each pull, so no draw can
+// be skipped.
+uniform sampler2D backbuffer;
+in vec2 screenUV;
+out vec4 color;
+void main( )
+{
+	color = texelFetch( backbuffer, ivec2( gl_FragCoord.xy ), 0 ) * 0.5 + vec4( 0.25 );
+}
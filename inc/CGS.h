@@ -17,7 +17,6 @@
 // * Resizable windows (by user corner dragging)
 // * Window size change listeners (ie, OGUI)
 // * Fullscreen+borderless support (SDL_WindowFlags)
-// * Enable on/off vsync (SDL_GL_SetSwapInterval)
 // * Loading mesh files (custom file format?)
 
 #ifndef CGS_H
@@ -26,6 +25,8 @@
 #include "CGSDepends.h"
 #include "CGSUtility.h"
 #include "CGSVectors.h"
+#include "CGSStateCache.h"
+#include "CGSFrameSync.h"
 
 // This is typed and assigned to be compatible with OpenGL's GLSL functions.
 enum class ShaderType : GLenum
@@ -37,34 +38,259 @@ enum class ShaderType : GLenum
 	FRAGMENT = GL_FRAGMENT_SHADER
 };
 
+// How render stages are given the result of everything rendered before them
+// (the backbuffer). See GraphicsSystem::init( ).
+enum class BackbufferStrategy : uint8_t
+{
+	COPY,
+	TEXTURE_BARRIER
+};
+
+// How buffer swaps are synchronized with the display. The values are those
+// taken by SDL_GL_SetSwapInterval( ). See GraphicsSystem::setPresentMode( ).
+enum class PresentMode : int8_t
+{
+	ADAPTIVE_VSYNC = -1,
+	IMMEDIATE = 0,
+	VSYNC = 1
+};
+
 // This can be changed to other types (like int, unsigned int...) if your specific
 // use needs/benefits from a different type for ordering render operations.
 // Float, however, has the nice effect of allowing huge ranges as well as being
 // directly relatable to depth.
+//
+// Whatever type is used must be 32 bits or smaller, as it is packed into the
+// upper half of the 64 bit sort key of each render command.
 typedef float CGSRenderOrderingType;
 
+// Where an operation is sorted within its stage, and whether it writes depth
+// when the render target has a depth attachment (see
+// GraphicsSystem::setDepthFormat( )). Stages render every SOLID operation,
+// then every LAYERED one, then every TRANSLUCENT one. For 3D content, use the
+// distance from the camera as the ordering:
+// * SOLID: rendered from lowest to highest ordering, which is front to back,
+// so that hidden fragments are rejected by the depth test before shading.
+// * LAYERED: rendered from lowest to highest ordering, as if there were no
+// classes at all. This is the default.
+// * TRANSLUCENT: rendered from highest to lowest ordering, which is back to
+// front, so blending composites correctly. Depth is tested but not written.
+enum class CGSRenderClass : uint8_t
+{
+	SOLID,
+	LAYERED,
+	TRANSLUCENT
+};
+
+// A rectangle of the render target in pixels, measured from the lower left
+// corner. A region with no width or height is unknown, and is treated as the
+// whole screen wherever a region is used.
+struct CGSScreenRegion
+{
+	uint16_t x;
+	uint16_t y;
+	uint16_t width;
+	uint16_t height;
+	
+	CGSScreenRegion(
+			const uint16_t& _x = 0,
+			const uint16_t& _y = 0,
+			const uint16_t& _width = 0,
+			const uint16_t& _height = 0 )
+			: x( _x ), y( _y ), width( _width ), height( _height ) {};
+	
+	inline bool isKnown( ) const { return width && height; }
+	
+	// Grows this region to the smallest one also covering _other. Both must be
+	// known.
+	inline void merge( const CGSScreenRegion& _other )
+	{
+		uint32_t right = U::max( (uint32_t)x + width, (uint32_t)_other.x + _other.width );
+		uint32_t top = U::max( (uint32_t)y + height, (uint32_t)_other.y + _other.height );
+		x = U::min( x, _other.x );
+		y = U::min( y, _other.y );
+		width = right - x;
+		height = top - y;
+	}
+	
+	// Both must be known.
+	inline bool intersects( const CGSScreenRegion& _other ) const
+	{
+		return (uint32_t)x < (uint32_t)_other.x + _other.width
+				&& (uint32_t)_other.x < (uint32_t)x + width
+				&& (uint32_t)y < (uint32_t)_other.y + _other.height
+				&& (uint32_t)_other.y < (uint32_t)y + height;
+	}
+	
+	inline bool contains( const CGSScreenRegion& _other ) const
+	{
+		return x <= _other.x && y <= _other.y
+				&& (uint32_t)_other.x + _other.width <= (uint32_t)x + width
+				&& (uint32_t)_other.y + _other.height <= (uint32_t)y + height;
+	}
+};
+
 struct CGSRenderOperation
 {
 	CGSMesh* mesh;
 	bool pullBackbuffer;
 	
+	// Per-instance data for meshes with instance attributes (see
+	// CGSMesh::createInstanceAttribute( )). instanceDataSize is the number of
+	// floats given, and instanceDataOffset is where they start within the
+	// instance data of whichever container holds the operation.
+	uint8_t instanceDataSize;
+	uint32_t instanceDataOffset;
+	
+	// The part of the screen the operation reads from the backbuffer. If
+	// unknown, the screen bounds of the mesh are used instead (see
+	// CGSMesh::setScreenBounds( )).
+	CGSScreenRegion region;
+	
+	CGSRenderClass renderClass;
+	
 	CGSRenderOperation(
 			CGSMesh* const& _mesh,
-			const bool& _pullBackbuffer = false )
-			: mesh( _mesh ), pullBackbuffer( _pullBackbuffer ) {};
+			const bool& _pullBackbuffer = false,
+			const uint8_t& _instanceDataSize = 0,
+			const uint32_t& _instanceDataOffset = 0,
+			const CGSScreenRegion& _region = CGSScreenRegion( ),
+			const CGSRenderClass& _renderClass = CGSRenderClass::LAYERED )
+			: mesh( _mesh ), pullBackbuffer( _pullBackbuffer ),
+			instanceDataSize( _instanceDataSize ),
+			instanceDataOffset( _instanceDataOffset ),
+			region( _region ), renderClass( _renderClass ) {};
+};
+
+// Identifies an operation in a retained render stage. See
+// CGSRenderStage::setRetained( ).
+typedef uint32_t CGSRenderOperationHandle;
+
+// Identifies a render target. See GraphicsSystem::createRenderTarget( ).
+typedef uint16_t CGSRenderTargetHandle;
+
+// A render operation along with the key it is sorted by. The key is laid out
+// from most to least significant as:
+// [ 2 bits class ][ 32 bits ordering ][ 11 bits program ][ 9 bits texture set ]
+// [ 10 bits VAO ]
+//
+// The class is the CGSRenderClass. The ordering is converted so that unsigned
+// comparison of the key gives the same order as comparing the
+// CGSRenderOrderingType values, so operations are rendered from lowest to
+// highest ordering; for TRANSLUCENT operations it is inverted, so they are
+// rendered from highest to lowest instead. Operations with equal ordering
+// are then grouped by the state they require, which reduces state changes.
+// The state fields are truncated handles and may collide; this only weakens the
+// grouping and has no effect on correctness.
+struct CGSRenderCommand
+{
+	uint64_t key;
+	CGSRenderOperation operation;
+	
+	CGSRenderCommand(
+			const uint64_t& _key,
+			const CGSRenderOperation& _operation )
+			: key( _key ), operation( _operation ) {};
+};
+
+// A list of render operations which can be recorded on any thread, then handed
+// to a render stage on the thread that uses CGS (see
+// CGSRenderStage::submitCommandList( )). This allows scene traversal to be
+// spread over several threads while all OpenGL access stays on one.
+//
+// A command list touches neither OpenGL nor any other CGS object; it only
+// stores the mesh pointers given to it. Each list must only be used by one
+// thread at a time, and meshes in a list must not be deleted before the list is
+// submitted. Use one list per thread (or per chunk of work) rather than sharing
+// one between threads; there is no locking.
+class CGSRenderCommandList
+{
+public:
+	// Same meaning as CGSRenderStage::insertOperation( ).
+	inline void insertOperation(
+			const CGSRenderOrderingType& _position,
+			CGSMesh* const& _mesh,
+			const bool& _pullBackbuffer = false,
+			const CGSScreenRegion& _region = CGSScreenRegion( ),
+			const CGSRenderClass& _renderClass = CGSRenderClass::LAYERED )
+	{
+		operations.push_back( U::p( _position, CGSRenderOperation(
+				_mesh, _pullBackbuffer, 0, 0, _region, _renderClass ) ) );
+	}
+	
+	inline void insertOperation(
+			const CGSRenderOrderingType& _position,
+			CGSMesh* const& _mesh,
+			const float* const& _instanceData,
+			const uint8_t& _instanceDataSize,
+			const bool& _pullBackbuffer = false,
+			const CGSScreenRegion& _region = CGSScreenRegion( ),
+			const CGSRenderClass& _renderClass = CGSRenderClass::LAYERED )
+	{
+		operations.push_back( U::p( _position, CGSRenderOperation(
+				_mesh, _pullBackbuffer, _instanceDataSize, instanceData.size( ), _region,
+				_renderClass ) ) );
+		instanceData.insert( instanceData.end( ), _instanceData, _instanceData + _instanceDataSize );
+	}
+	
+	// Preallocate room for _count operations.
+	inline void reserve( const size_t& _count ) { operations.reserve( _count ); }
+	inline size_t size( ) const { return operations.size( ); }
+	
+	// Empties the list, keeping its memory for reuse.
+	inline void clear( ) { operations.clear( ); instanceData.clear( ); }
+	
+	inline const Array< Pair< CGSRenderOrderingType, CGSRenderOperation > >& _getOperations( ) const
+	{
+		return operations;
+	}
+	
+	inline const Array< float >& _getInstanceData( ) const { return instanceData; }
+	
+protected:
+	Array< Pair< CGSRenderOrderingType, CGSRenderOperation > > operations;
+	Array< float > instanceData;
 };
 
 class CGSRenderStage
 {
 public:
 	const static uint8_t DEFAULT_BACK_BUFFER_TEXTURE_UNIT; // = 7
+	const static CGSRenderOperationHandle INVALID_OPERATION_HANDLE; // = 0
+	
+	// The render target shown at the end of render( ). Every stage renders to
+	// it unless told otherwise.
+	const static CGSRenderTargetHandle SCREEN_TARGET; // = 0
 	
 	// backbufferTextureUnit is which unit the backbuffer texture will be bound
 	// to. CGS assumes you do not bind any textures in this render stage to that
 	// unit. This is not checked against currently; if you do bind to the unit,
 	// you will cause undefined behavior.
 	CGSRenderStage( const uint8_t& _backbufferTextureUnit = DEFAULT_BACK_BUFFER_TEXTURE_UNIT )
-			: backbufferTextureUnit( _backbufferTextureUnit ) {};
+			: backbufferTextureUnit( _backbufferTextureUnit ),
+			output( SCREEN_TARGET ), resolutionDivisor( 1 ), cacheable( false ),
+			retained( false ), commandsDirty( false ),
+			nextOperationHandle( INVALID_OPERATION_HANDLE + 1 ),
+			damageSignature( 0 ), damageCoversNothing( true ) {};
+	
+	// By default, a render stage is immediate: all of its operations are removed
+	// at the end of each frame, and must be inserted again for the next one.
+	//
+	// A retained stage keeps its operations across frames until they are
+	// removed. The sorted draw list is only rebuilt when operations are added,
+	// removed or reordered, so an unchanged retained stage costs almost nothing
+	// to prepare. Operations referring to a mesh are removed automatically when
+	// the mesh is deleted.
+	//
+	// The sort keys of a retained stage are computed again each time its draw
+	// list is rebuilt, which only happens when operations are added, removed or
+	// reordered. If you change the textures attached to the mesh of an
+	// operation, it still renders correctly, but may not be grouped optimally
+	// with others until the next rebuild.
+	//
+	// Changing the mode removes all operations from the stage.
+	void setRetained( const bool& _retained );
+	inline bool isRetained( ) const { return retained; }
 	
 	// Add a render operation with the given ordering to the render stage.
 	// 
@@ -80,22 +306,228 @@ public:
 	//
 	// According to my tests, _pullBackbuffer is not actually that costly on
 	// modern hardware, but be aware it COULD be on a given system.
-	void insertOperation(
+	//
+	// A pull only copies the part of the screen that the operations up to the
+	// next pull will read, if all of them say so: either by passing _region, or
+	// through the screen bounds of their meshes (CGSMesh::setScreenBounds( )).
+	// If any of them gives neither, the whole screen is copied. The same goes
+	// for the copy at the start of each stage. Reading the backbuffer outside
+	// the region given gives stale results.
+	//
+	// Operations with the same ordering are not guaranteed to render in the order
+	// they were inserted; they are grouped by program, textures and VAO instead.
+	// Use distinct ordering values if the order between two operations matters.
+	//
+	// _renderClass moves the operation before or after the others and decides
+	// whether it writes depth; see CGSRenderClass.
+	//
+	// In a retained stage, returns a handle which can be passed to
+	// removeOperation( ) and reorderOperation( ). In an immediate stage, returns
+	// INVALID_OPERATION_HANDLE.
+	CGSRenderOperationHandle insertOperation(
 			const CGSRenderOrderingType& _position,
 			CGSMesh* const& _mesh,
-			const bool& _pullBackbuffer = false );
+			const bool& _pullBackbuffer = false,
+			const CGSScreenRegion& _region = CGSScreenRegion( ),
+			const CGSRenderClass& _renderClass = CGSRenderClass::LAYERED );
+	
+	// As above, but also gives _instanceDataSize floats of per-instance data for
+	// the operation, which are copied. The mesh reads them through its instance
+	// attributes (see CGSMesh::createInstanceAttribute( )).
+	//
+	// Consecutive operations on the same mesh are always drawn with a single
+	// instanced draw call, whether or not they have instance data. If the mesh
+	// expects more instance data than an operation gave, the rest is zero; extra
+	// data is ignored.
+	CGSRenderOperationHandle insertOperation(
+			const CGSRenderOrderingType& _position,
+			CGSMesh* const& _mesh,
+			const float* const& _instanceData,
+			const uint8_t& _instanceDataSize,
+			const bool& _pullBackbuffer = false,
+			const CGSScreenRegion& _region = CGSScreenRegion( ),
+			const CGSRenderClass& _renderClass = CGSRenderClass::LAYERED );
+	
+	// Retained stages only. Each returns true if _handle referred to an
+	// operation in this stage, and false if it did not.
+	bool removeOperation( const CGSRenderOperationHandle& _handle );
+	bool reorderOperation(
+			const CGSRenderOperationHandle& _handle,
+			const CGSRenderOrderingType& _position );
+	
+	// Removes every operation from the stage, in either mode.
+	void clearOperations( );
+	
+	// Inserts every operation recorded in _list, as if insertOperation( ) was
+	// called for each, then clears _list. This must be called from the thread
+	// that uses CGS, and not while any other thread is writing to _list. Lists
+	// may be submitted in any order; operations are sorted together at render.
+	//
+	// For retained stages, the handles of the new operations are appended to
+	// _handles, if given, in the order they were recorded.
+	void submitCommandList(
+			CGSRenderCommandList& _list,
+			Array< CGSRenderOperationHandle >* const& _handles = NULL );
+	
+	// RENDER GRAPH ==============================================================
+	
+	// Sets the render target the stage renders to. With render( ), stages which
+	// render to a target are moved before the stages which read it, and stages
+	// whose output is never read (directly or through other stages) by a stage
+	// rendering to the screen are not rendered at all.
+	//
+	// Backbuffer pulls only apply to stages rendering to the screen target.
+	// Other stages get earlier results through their inputs instead.
+	inline void setOutput( const CGSRenderTargetHandle& _target ) { output = _target; }
+	inline CGSRenderTargetHandle getOutput( ) const { return output; }
+	
+	// Binds what earlier stages rendered this frame to _target onto texture
+	// unit _unit while this stage renders. If the stage already reads _target,
+	// only its unit is changed. The stage's own output is never bound, and a
+	// target no stage rendered to this frame reads as undefined.
+	//
+	// Reading SCREEN_TARGET reads what lower indexed stages rendered to the
+	// screen. An input on the backbuffer unit replaces the backbuffer, so the
+	// stage does not pull.
+	void addInput( const CGSRenderTargetHandle& _target, const uint8_t& _unit );
+	
+	// Returns true if the stage read _target.
+	bool removeInput( const CGSRenderTargetHandle& _target );
+	
+	inline const Array< Pair< CGSRenderTargetHandle, uint8_t > >& getInputs( ) const
+	{
+		return inputs;
+	}
+	
+	// Renders a stage whose output is the screen at 1/_divisor of the screen
+	// size in each dimension; 2 and 4 cost a quarter and a sixteenth of the
+	// fill rate. Suits blurred backgrounds, glows and shadows. 1 (the
+	// default) renders at full resolution.
+	//
+	// The stage renders to a transient target of its own, cleared to zero,
+	// which is then upsampled with linear filtering and blended over the
+	// screen before the next stage: color is taken to be premultiplied by
+	// alpha, so render with glBlendFunc( GL_ONE, GL_ONE_MINUS_SRC_ALPHA ) or
+	// opaquely. Like stages rendering to targets, the stage does not pull the
+	// backbuffer and is not depth tested; read the screen through an input
+	// instead. Has no effect on stages rendering to a target, whose size is
+	// set by the target (see GraphicsSystem::createRenderTarget( )).
+	inline void setResolutionDivisor( const uint8_t& _divisor )
+	{
+		resolutionDivisor = U::max( _divisor, (uint8_t)1 );
+	}
+	inline uint8_t getResolutionDivisor( ) const { return resolutionDivisor; }
+	
+	// A cacheable stage keeps what it rendered in a texture of its own, and
+	// while none of its operations, or the meshes, uniforms and textures they
+	// use, have changed, draws that texture over the screen in place of
+	// rendering again. Use it for stages whose pixels rarely change, such as
+	// static backgrounds and the panels behind dialogs.
+	//
+	// The texture is composited as a reduced resolution stage is (see
+	// setResolutionDivisor( ), which also applies), so the same limits hold:
+	// color is premultiplied by alpha, and the stage neither pulls the
+	// backbuffer nor is depth tested. Only stages rendering to the screen
+	// without inputs are cached, as inputs may change every frame; others
+	// render as usual. Occlusion tested meshes are drawn untested in a cached
+	// stage (see CGSMesh::setOcclusionProxy( )).
+	inline void setCacheable( const bool& _cacheable ) { cacheable = _cacheable; }
+	inline bool isCacheable( ) const { return cacheable; }
 	
 	// Render cycle internal functions.
 	inline uint8_t _getBackbufferTextureUnit( ) { return backbufferTextureUnit; }
 	
-	inline AssocArrayMulti< CGSRenderOrderingType, CGSRenderOperation >& _getOperations( )
+	// Sorts the commands by key. Called once per frame by render( ). In a
+	// retained stage, this does nothing unless the operations changed.
+	void _sortCommands( );
+	
+	// Called at the end of each frame. Clears the operations of immediate stages.
+	void _endFrame( );
+	
+	// Removes all operations using _mesh. Called when a mesh is deleted.
+	void _removeMesh( CGSMesh* const& _mesh );
+	
+	inline Array< CGSRenderCommand >& _getCommands( )
 	{
-		return operations;
+		return commands;
+	}
+	
+	// The instance data of the sorted commands, packed in render order with the
+	// size each mesh expects. Valid after _sortCommands( ); the instanceDataOffset
+	// of each command then refers to this.
+	inline const Array< float >& _getSortedInstanceData( ) const
+	{
+		return sortedInstanceData;
 	}
 	
+	// Returns the index one past the end of the run of commands starting at
+	// _start which can be drawn as one instanced draw: the same mesh and render
+	// class, with no backbuffer pulls after the first.
+	size_t _findInstanceRunEnd( const size_t& _start ) const;
+	
+	// Returns the region of the backbuffer which the commands from _start up to
+	// the next pull read, or an unknown region if that is not known.
+	CGSScreenRegion _findPullRegion( const size_t& _start ) const;
+	
+	// Compares the sorted commands, output, inputs and resolution divisor with
+	// those seen by the last call. If they differ, sets _damage to what the
+	// commands of both calls cover, which is unknown if any of them covers an
+	// unknown region, and returns true. Used for damage tracking; see
+	// GraphicsSystem::setDamageTracking( ).
+	bool _findCommandDamage( CGSScreenRegion& _damage );
+	
+	// Builds the sort key for an operation. See CGSRenderCommand.
+	static uint64_t _generateSortKey(
+			const CGSRenderOrderingType& _position,
+			const CGSRenderOperation& _operation );
+	
 protected:
-	AssocArrayMulti< CGSRenderOrderingType, CGSRenderOperation > operations;
+	// Commands are appended unsorted and sorted once per frame with a radix sort.
+	// sortBuffer is the scratch space for the sort; it is kept between frames so
+	// that steady-state frames do not allocate.
+	Array< CGSRenderCommand > commands;
+	Array< CGSRenderCommand > sortBuffer;
 	uint8_t backbufferTextureUnit;
+	
+	// Render graph. Inputs are < target, texture unit >.
+	CGSRenderTargetHandle output;
+	Array< Pair< CGSRenderTargetHandle, uint8_t > > inputs;
+	uint8_t resolutionDivisor;
+	bool cacheable;
+	
+	// Retained mode. The operations are the authoritative copy; commands is
+	// rebuilt from them when commandsDirty is set. Ordered by handle, so equal
+	// keys keep their insertion order through each rebuild.
+	struct RetainedOperation
+	{
+		CGSRenderOrderingType position;
+		CGSRenderOperation operation;
+		Array< float > instanceData;
+	};
+	
+	bool retained;
+	bool commandsDirty;
+	CGSRenderOperationHandle nextOperationHandle;
+	AssocArray< CGSRenderOperationHandle, RetainedOperation > retainedOperations;
+	
+	// Instance data of the operations in commands, in insertion order, and the
+	// same data packed after sorting. See _getSortedInstanceData( ).
+	Array< float > instanceData;
+	Array< float > sortedInstanceData;
+	
+	// Back-end for _sortCommands( ), sorting whatever is in commands.
+	void _radixSortCommands( );
+	
+	// Fills sortedInstanceData from instanceData in command order.
+	void _packInstanceData( );
+	
+	// What _findCommandDamage( ) saw last: a hash of the commands, output,
+	// inputs and divisor, and the region the commands covered. damageBounds is
+	// unknown both when they covered nothing and when they covered an unknown
+	// region.
+	uint64_t damageSignature;
+	CGSScreenRegion damageBounds;
+	bool damageCoversNothing;
 };
 
 class GraphicsSystem
@@ -118,14 +550,40 @@ public:
 	const static char* DEFAULT_SHADER_NAME; // = "default"
 	const static char* DEFAULT_SHADER_PATH; // = "glsl/"
 	
+	// The name of the vertex shader of compositor meshes. See
+	// createCompositorMesh( ).
+	const static char* COMPOSITOR_SHADER_NAME; // = "compositor"
+	
 	GraphicsSystem( const bool& _disableDebug = false );
 	~GraphicsSystem( );
 
+	// _backbufferStrategy selects how the backbuffer is updated at the start of
+	// each stage and for each operation that pulls it:
+	// * COPY: the render target is copied to a separate backbuffer texture. Reads
+	// see exactly what was drawn before the pull. Every pull copies the whole
+	// screen, and the backbuffer texture takes as much memory as the target.
+	// * TEXTURE_BARRIER: the render target itself is bound as the backbuffer,
+	// and a pull is only a glTextureBarrier( ). There is no copy and no second
+	// texture. However, reads are only defined for a texel which, since the
+	// last pull or stage transition (each of which is a barrier), either:
+	//   - no draw has written, or
+	//   - has been written once, by the fragment reading it, and only ever
+	//     read at its own position (texelFetch( ) at gl_FragCoord).
+	// Reading anything else is undefined, and that includes texels written by
+	// an earlier draw in the same stage, not only texels of other primitives
+	// in the same draw. Pull before any mesh which reads what has been drawn
+	// since the last pull. Requires OpenGL 4.5, GL_ARB_texture_barrier or
+	// GL_NV_texture_barrier; otherwise COPY is used instead.
+	//
+	// _internalFormat is the format of the render target every stage draws to
+	// (and of the backbuffer copied from it). See setInternalFormat( ).
 	bool init(
 		const uint16_t& x,
 		const uint16_t& y,
 		const String& windowName,
-		const String& _shaderPath = DEFAULT_SHADER_PATH );
+		const String& _shaderPath = DEFAULT_SHADER_PATH,
+		const BackbufferStrategy& _backbufferStrategy = BackbufferStrategy::COPY,
+		const GLenum& _internalFormat = GL_RGBA32F );
 	
 	inline static GraphicsSystem* const& getGlobalInstance( )
 	{
@@ -135,15 +593,166 @@ public:
 	inline const uint16_t& getScreenX( ) const { return screenX; }
 	inline const uint16_t& getScreenY( ) const { return screenY; }
 	
+	// The strategy actually in use, which is COPY if the one requested from
+	// init( ) is not supported.
+	inline BackbufferStrategy getBackbufferStrategy( ) const { return backbufferStrategy; }
+	
+	// Changes the format of the render target, replacing its textures. Their
+	// contents are lost, so call this between frames. Smaller formats cut the
+	// fill and copy bandwidth of every stage, pull and the final blit; RGBA32F
+	// is 16 bytes per pixel, RGBA16F is 8 and RGBA8 is 4. Supported formats are
+	// GL_RGBA8, GL_SRGB8_ALPHA8, GL_RGB10_A2, GL_RGBA16, GL_R11F_G11F_B10F,
+	// GL_RGBA16F and GL_RGBA32F. Returns false, keeping the current format, if
+	// _internalFormat is not one of them or cannot be rendered to.
+	bool setInternalFormat( const GLenum& _internalFormat );
+	inline GLenum getInternalFormat( ) const { return internalFormat; }
+	
+	// Gives the screen render target a depth attachment of _depthFormat, which
+	// is one of GL_DEPTH_COMPONENT16, GL_DEPTH_COMPONENT24,
+	// GL_DEPTH_COMPONENT32F, GL_DEPTH24_STENCIL8 or GL_DEPTH32F_STENCIL8, or
+	// removes it with GL_NONE (the default). The stencil formats also give it
+	// a stencil attachment.
+	//
+	// While there is a depth attachment, depth testing is enabled with
+	// GL_LEQUAL, and depth (and stencil) is cleared at the start of each frame.
+	// Operations write depth unless they are TRANSLUCENT (see CGSRenderClass).
+	// Other render targets never have depth, so stages rendering to them are
+	// not depth tested. Returns false, keeping the current attachment, if the
+	// format is not supported.
+	bool setDepthFormat( const GLenum& _depthFormat );
+	inline GLenum getDepthFormat( ) const { return depthFormat; }
+	
 	// If set to true, will print extra debug information to the console.
 	void setDebugMode( const bool& _mode );
 	inline const bool& getDebugMode( ) { return debugMode; }
 	
+	// The OpenGL state tracker used by CGS to skip redundant binds. Its call
+	// counters describe the last frame rendered. If you make your own OpenGL
+	// calls which change bindings, call invalidate( ) on it afterwards.
+	inline CGSStateCache& _getStateCache( ) { return stateCache; }
+	
+	// Fences each frame, and limits how far the CPU may get ahead of the GPU.
+	// See CGSFrameSync.
+	inline CGSFrameSync& getFrameSync( ) { return frameSync; }
+	
+	// IMMEDIATE (the default) swaps as soon as a frame is finished, which gives
+	// the lowest latency but may tear. VSYNC waits for the vertical blank.
+	// ADAPTIVE_VSYNC waits too, unless the frame already missed one, in which
+	// case it swaps at once (and may tear) rather than waiting a whole refresh.
+	// Returns false, keeping the current mode, if the driver does not support
+	// _mode. ADAPTIVE_VSYNC falls back to VSYNC before failing.
+	bool setPresentMode( const PresentMode& _mode );
+	inline PresentMode getPresentMode( ) const { return presentMode; }
+	
+	// Caps the frame rate at _framesPerSecond by sleeping at the start of each
+	// frame, until 1 / _framesPerSecond seconds after the previous one started.
+	// 0 (the default) removes the limit. Unlike VSYNC, this keeps the driver
+	// from queueing up frames ahead of the display, so input is sampled later.
+	void setFrameLimit( const float& _framesPerSecond );
+	inline float getFrameLimit( ) const { return frameLimit; }
+	
+	// Starts the next frame: waits if the GPU is too far behind (see
+	// CGSFrameSync), then for the frame limit. render( ) calls this itself if it
+	// has not been called since the last frame. Call it before polling input,
+	// so the input is sampled after the waits rather than before them.
+	void waitForFrameStart( );
+	
+	// Late-latch: render( ) calls _callback after every wait, just before the
+	// stages are sorted and submitted. Input-dependent work done there (such as
+	// setting the camera uniforms from the latest mouse position) is as fresh
+	// as possible when the GPU gets it. An empty function removes the callback.
+	void setLateLatchCallback( const std::function< void( ) >& _callback );
+	
+	// Milliseconds from the start of a frame (see waitForFrameStart( )) to the
+	// GPU reaching its swap, measured on the GPU clock. It is for the most
+	// recent frame known to be complete, a frame or two behind the one being
+	// recorded, and 0 until there is one. The display's own scan-out delay is
+	// not included.
+	inline double getFrameLatency( ) const { return frameLatency; }
+	
+	// With damage tracking, render( ) only redraws the part of the screen which
+	// changed since the last frame (the damage), under a scissor, and skips
+	// frames where nothing changed entirely: no stage is rendered and there is
+	// no swap. Off by default, which redraws everything every frame.
+	//
+	// The damage is found from:
+	// * Changes to meshes: their data, shaders, uniforms, textures, visibility
+	// and screen bounds. Each damages the screen bounds of the mesh (see
+	// CGSMesh::setScreenBounds( )), or the whole screen if they are unknown.
+	// Setting a uniform of a program shared by several meshes damages the
+	// whole screen.
+	// * Changes to the operations of each stage from one frame to the next.
+	// These damage what the operations cover, as backbuffer pulls do.
+	// * addDamage( ), for anything else.
+	//
+	// Operations which pull the backbuffer, and overlap the damage, grow it to
+	// cover the region they read. The whole screen is redrawn when anything
+	// changed if any stage renders to a render target or has inputs.
+	//
+	// Skipped frames do not wait for vsync, so limit the frame rate (see
+	// setFrameLimit( )) to keep an idle render loop from spinning.
+	void setDamageTracking( const bool& _tracking );
+	inline bool getDamageTracking( ) const { return damageTracking; }
+	
+	// Reports that _region of the screen changed in a way CGS cannot see, such
+	// as through your own OpenGL calls. An unknown region (the default) damages
+	// the whole screen. Does nothing without damage tracking.
+	void addDamage( const CGSScreenRegion& _region = CGSScreenRegion( ) );
+	
+	// Whether the last call to render( ) skipped the frame, and if it did not,
+	// the region it redrew; unknown if that was the whole screen.
+	inline bool wasFrameSkipped( ) const { return frameSkipped; }
+	inline const CGSScreenRegion& getLastDamage( ) const { return lastDamage; }
+	
+	// Renders every stage into the lower left part of its target, _scale times
+	// its size in each dimension, and upscales the screen target to the window
+	// with linear filtering. _scale is clamped to [ 0.25, 1 ]. Targets keep
+	// their full size, so the scale can change every frame without allocating.
+	//
+	// Regions (see CGSScreenRegion) are still given in window pixels; CGS
+	// scales them. Shaders reading the backbuffer or render targets by
+	// normalized coordinates must multiply them by the scale; compositor
+	// meshes do this themselves (see createCompositorMesh( )). Coordinates
+	// from gl_FragCoord need no change.
+	void setResolutionScale( const float& _scale );
+	inline float getResolutionScale( ) const { return resolutionScale; }
+	
+	// Lets render( ) pick the resolution scale itself, to keep the GPU time of
+	// each frame within _budget milliseconds: 16.6 holds 60 Hz. The scale
+	// drops as soon as frames go over the budget, and rises slowly once they
+	// are well under it, never going below _minimumScale. A budget of 0 (the
+	// default) turns this off, keeping the scale where it is.
+	void setDynamicResolution( const float& _budget, const float& _minimumScale = 0.5f );
+	inline float getDynamicResolutionBudget( ) const { return resolutionBudget; }
+	
+	// Milliseconds the GPU spent rendering the stages of the most recent frame
+	// known to be complete, measured with GL_TIME_ELAPSED queries. The final
+	// blit and the swap are not included. 0 until a frame is complete.
+	inline double getGPUFrameTime( ) const { return gpuFrameTime; }
+	
 	// RENDER SYSTEM FUNCTIONS ===================================================
 	// Functions in this section are defined in CGSRenderQueue.cpp, not CGS.cpp.
 	
-	// Generates a mesh set up specifically for compositing; effectively just a
-	// mesh which occupies the entire screen.
+	// Generates a mesh set up specifically for compositing: a single triangle
+	// covering the whole render target, with fragmentShader (loaded as by
+	// CGSMesh::loadFragmentShader( )). The mesh has no vertex data; a built-in
+	// vertex shader makes up the triangle from gl_VertexID, and all compositor
+	// meshes share one empty VAO. The fragment shader is given
+	//     in vec2 screenUV;
+	// which is the texture coordinate of the fragment in the backbuffer and
+	// render targets. It runs from ( 0, 0 ) at the lower left of the target to
+	// ( 1, 1 ) at the upper right, or only to the resolution scale below full
+	// resolution (see setResolutionScale( )). The triangle lies on the near
+	// plane, so it passes any depth test with GL_LEQUAL.
+	//
+	// To replace the vertex shader, load one with getShader( ) under
+	// COMPOSITOR_SHADER_NAME before the first compositor mesh is created. It is
+	// given the resolution scale in
+	//     uniform vec2 cgsResolutionScale;
+	// which is set every frame.
+	//
+	// Returns NULL if fragmentShader is empty or fails to load or build. See
+	// CGSPostProcessChain for chaining compositor passes.
 	CGSMesh* createCompositorMesh( const String& fragmentShader = "" );
 	
 	// Render queue stages. They are rendered in the order of the index they are
@@ -155,13 +764,57 @@ public:
 	// Each subsequent stage will have access to the cumulative backbuffer of the
 	// previous stages. When complete, the render target is written to the default
 	// framebuffer (ie, it is shown).
+	//
+	// If stages render to and read from render targets (see
+	// CGSRenderStage::setOutput( ) and addInput( )), each stage is moved after
+	// the stages rendering to the targets it reads, and stages whose output is
+	// never used are skipped. See createRenderTarget( ).
 	void render( );
 	
 	// Behaves like render( ), except that stages are ordered according to the
 	// indexes in the array passed. Passing { 0, 1, 0, 2 } will render stage 0,
 	// then 1, then 0 again, then 2. As with the raw render( ) function, each 
-	// stage has access to the cumulative backbuffer of previous stages.
-//	void render( const Array< uint8_t >& stagesToRender );
+	// stage has access to the cumulative backbuffer of previous stages. Stages
+	// are rendered exactly as listed; none are moved or skipped.
+	void render( const Array< uint8_t >& stagesToRender );
+	
+	// Creates a transient render target for render stages to render to and read
+	// from. It is 1/_sizeDivisor of the screen size in each dimension, and uses
+	// _internalFormat (a sized format such as GL_RGBA16F). GL_NONE uses the
+	// format of the screen target, following setInternalFormat( ).
+	//
+	// The contents of a transient target only last for the frame: it is cleared
+	// to zero before the first stage rendering to it each frame. Targets do not
+	// own textures. Each frame, they are given textures from a pool, and two
+	// targets whose uses do not overlap in the stage order can share one. Pooled
+	// textures not used for a frame are released.
+	//
+	// If a texture of the target's size and format cannot be rendered to,
+	// stages rendering to the target are skipped. This is logged once, and not
+	// tried again, for each size and format.
+	CGSRenderTargetHandle createRenderTarget(
+			const uint8_t& _sizeDivisor = 1,
+			const GLenum& _internalFormat = GL_NONE );
+	
+	// Also removes the target from the inputs of every stage. Stages rendering
+	// to it are skipped until given another output.
+	bool deleteRenderTarget( const CGSRenderTargetHandle& _target );
+	
+	// Enables drawing consecutive operations with a single glMultiDraw*Indirect( )
+	// call when their meshes share a program (see CGSMesh::shareProgram( )) and
+	// have the same vertex format, render operation and textures. Runs of the
+	// same mesh are still combined into one instanced draw within that call.
+	// Backbuffer pulls always end a multi-draw.
+	//
+	// Meshes drawn this way are also copied into a buffer shared by all meshes
+	// of their vertex format, which costs GPU memory and a GPU-side copy each
+	// time a mesh uploads new data. It pays off when there are many meshes that
+	// change rarely.
+	//
+	// Disabled by default. Requires OpenGL 4.3, or GL_ARB_multi_draw_indirect
+	// and GL_ARB_base_instance; returns false and stays disabled otherwise.
+	bool setMultiDrawIndirect( const bool& _enabled );
+	inline bool getMultiDrawIndirect( ) const { return multiDrawIndirect; }
 	
 	// SHADER FUNCTIONS ==========================================================
 	
@@ -187,8 +840,31 @@ public:
 	
 	// MESH FUNCTIONS ============================================================
 	CGSMesh* createMesh( const GLenum& _renderOperation = GL_POINTS );
+	
+	// Also removes the mesh from any retained render stage.
 	void _notifyMeshDeleted( CGSMesh* const& mesh );
 	
+	// Called by CGSMesh::setOcclusionProxy( ), so deleting a proxy can clear
+	// it from the meshes using it.
+	void _notifyOcclusionProxyChanged( CGSMesh* const& _mesh );
+	
+	// Adds _mesh to the meshes render( ) updates next frame. Only meshes queued
+	// here are updated, so render( ) costs nothing for meshes left unchanged.
+	inline void _queueMeshUpdate( CGSMesh* const& _mesh ) { meshUpdateQueue.insert( _mesh ); }
+	
+	// Reference counting for programs shared between meshes (see
+	// CGSMesh::shareProgram( )). A program created by a mesh has one user
+	// without being retained. _releaseProgram( ) returns true if the caller was
+	// the last user, and should delete the program.
+	void _retainProgram( const GLuint& _program );
+	bool _releaseProgram( const GLuint& _program );
+	bool _isProgramShared( const GLuint& _program ) const;
+	
+	// Called when a uniform of a shared program is set. Which meshes share it is
+	// not tracked, so this invalidates every cached stage drawing a mesh with a
+	// shared program.
+	inline void _notifySharedUniformChanged( ) { ++sharedUniformChanges; }
+	
 	// TEXTURE FUNCTIONS =========================================================
 	
 	// Generates a blank (zeroed) texture with the requested parameters.
@@ -229,6 +905,9 @@ public:
 	
 	void _textureRequestDeletion( CGSTexture* const& texture );
 	
+	// As _queueMeshUpdate( ), for textures.
+	inline void _queueTextureUpdate( CGSTexture* const& _texture ) { textureUpdateQueue.insert( _texture ); }
+	
 	// INFORMATION FUNCTIONS =====================================================
 	
 	// Returns the size in bytes of an OpenGL type identified by the passed enum;
@@ -259,6 +938,14 @@ public:
 	
 	static void getOpenGLErrors( );
 	
+	// Returns true if the OpenGL context is at least version _major._minor.
+	// Only valid after init( ).
+	bool isOpenGLVersionSupported( const GLint& _major, const GLint& _minor ) const;
+	
+	// Returns true if the OpenGL context reports the extension named _name,
+	// such as "GL_ARB_multi_draw_indirect". Only valid after init( ).
+	bool isExtensionSupported( const String& _name ) const;
+	
 protected:
 	static GraphicsSystem* globalInstance;
 	
@@ -272,13 +959,288 @@ protected:
 	GLuint framebufferHandle; // FBO
 	GLuint framebufferInternalTextureHandle; // Texture
 	GLuint backbufferTextureHandle; // Texture
+	GLenum internalFormat; // Of both textures above
+	GLuint depthRenderbufferHandle; // Attached to framebufferHandle, if any
+	GLenum depthFormat;
+	
+	// Instance data of all stages, rewritten every frame. There is one buffer
+	// per frame in flight, so a frame never writes to a buffer the GPU may
+	// still be reading. instanceBufferHandle is the one for the current frame.
+	GLuint instanceBufferHandles[ CGSFrameSync::MAX_FRAMES_IN_FLIGHT ];
+	size_t instanceBufferCapacities[ CGSFrameSync::MAX_FRAMES_IN_FLIGHT ]; // Floats
+	GLuint instanceBufferHandle;
+	
+	// Bound by every compositor mesh. See createCompositorMesh( ).
+	GLuint emptyVAOHandle;
+	const static char* COMPOSITOR_VERTEX_SHADER_SOURCE;
+	
+	BackbufferStrategy backbufferStrategy;
+	bool useNVTextureBarrier; // glTextureBarrierNV( ) in place of glTextureBarrier( )
 	AssocArray< uint8_t, CGSRenderStage > renderStages;
 	
+	// Multi-draw indirect. Pools are keyed by CGSMesh::_getVertexFormatKey( ).
+	// indirectCommands is scratch space for building each multi-draw.
+	bool multiDrawIndirect;
+	GLuint indirectBufferHandle;
+	UnorderedAssocArray< String, CGSMultiDrawPool* > multiDrawPools;
+	
+	// Meshes with an occlusion proxy. See CGSMesh::setOcclusionProxy( ).
+	UnorderedSet< CGSMesh* > occlusionTestedMeshes;
+	Array< GLuint > indirectCommands;
+	
+	// Render graph. See createRenderTarget( ).
+	struct RenderTarget
+	{
+		uint8_t sizeDivisor;
+		GLenum internalFormat;
+	};
+	
+	struct PooledRenderTarget
+	{
+		GLuint texture;
+		GLuint framebuffer;
+		uint16_t width;
+		uint16_t height;
+		GLenum internalFormat;
+		
+		// Whether a target uses this in the current frame, and the position in
+		// the stage order from which it is free again.
+		bool used;
+		size_t freeFrom;
+		
+		// Frames in a row no target has used this. It is released only after
+		// several, so that stages rendered every other frame do not recreate it
+		// each time.
+		uint8_t unusedFrames;
+	};
+	
+	CGSRenderTargetHandle nextRenderTargetHandle;
+	AssocArray< CGSRenderTargetHandle, RenderTarget > renderTargets;
+	Array< PooledRenderTarget > renderTargetPool;
+	
+	// Pooled textures which could not be created, by _getTargetDescriptor( ).
+	// Creating them again would fail again, so they are not retried.
+	UnorderedSet< uint64_t > failedRenderTargets;
+	
+	// Packs the size and format of a pooled texture into one key.
+	inline static uint64_t _getTargetDescriptor(
+			const uint16_t& _width,
+			const uint16_t& _height,
+			const GLenum& _internalFormat )
+	{
+		return ( (uint64_t)_internalFormat << 32 ) | ( (uint64_t)_width << 16 ) | _height;
+	}
+	
+	// Reduced resolution stages. Each renders to a target of its own, made
+	// on first use and kept by stage index, which is then drawn over the
+	// screen by upsampleProgramHandle. See
+	// CGSRenderStage::setResolutionDivisor( ).
+	AssocArray< uint8_t, CGSRenderTargetHandle > reducedStageTargets;
+	GLuint upsampleProgramHandle;
+	GLint upsampleResolutionScaleLocation;
+	const static char* UPSAMPLE_FRAGMENT_SHADER_SOURCE;
+	
+	// Cached stages. See CGSRenderStage::setCacheable( ). Unlike pooled
+	// targets, each is kept from frame to frame for one stage. signature
+	// describes what was rendered into it; see _getStageCacheSignature( ).
+	struct StageCache
+	{
+		GLuint texture;
+		GLuint framebuffer;
+		uint16_t width;
+		uint16_t height;
+		GLenum internalFormat;
+		uint64_t signature;
+		bool valid;
+	};
+	
+	AssocArray< uint8_t, StageCache > stageCaches;
+	uint64_t sharedUniformChanges; // See _notifySharedUniformChanged( )
+	
+	// True if _stage is rendered through its cache.
+	inline bool _isStageCached( const CGSRenderStage& _stage ) const
+	{
+		return _stage.isCacheable( )
+				&& _stage.getOutput( ) == CGSRenderStage::SCREEN_TARGET
+				&& _stage.getInputs( ).empty( );
+	}
+	
+	// Returns the cache of stage _index, (re)creating its texture if the size
+	// or format it needs changed, which invalidates it.
+	StageCache& _getStageCache( const uint8_t& _index, const CGSRenderStage& _stage );
+	
+	// Deletes the cache of stage _index, if it has one.
+	void _deleteStageCache( const uint8_t& _index );
+	
+	// A hash of everything that decides what a cached stage renders: its
+	// commands and instance data, the changes to their meshes, and the
+	// resolution.
+	uint64_t _getStageCacheSignature( CGSRenderStage& _stage ) const;
+	
+	// Creates a texture of one level, with linear filtering, and a framebuffer
+	// rendering to it. Used for pooled targets and stage caches. Returns false,
+	// creating nothing, if the framebuffer is incomplete.
+	bool _createTargetTexture(
+			const uint16_t& _width,
+			const uint16_t& _height,
+			const GLenum& _internalFormat,
+			GLuint& _texture,
+			GLuint& _framebuffer );
+	
+	// The target stage _index renders to: its output, or its own target if it
+	// renders to the screen at reduced resolution and is not cached.
+	CGSRenderTargetHandle _getStageTarget( const uint8_t& _index, const CGSRenderStage& _stage );
+	
+	// Deletes the target of stage _index kept in reducedStageTargets, if any.
+	void _releaseStageTarget( const uint8_t& _index );
+	
+	// Blends the lower left of _texture, which is _width by _height, over the
+	// screen target, as rendered by a reduced resolution or cached stage.
+	// _depthWrites is whether the depth mask is on. Returns false if the
+	// upsampling program failed to build.
+	bool _compositeStageTexture(
+			const GLuint& _texture,
+			const uint16_t& _width,
+			const uint16_t& _height,
+			const bool& _depthWrites );
+	
+	// Returns the stages render( ) renders, in order.
+	Array< uint8_t > _buildRenderGraph( );
+	
+	// Assigns a pooled texture to every target used by the stages in _order.
+	// _assignments maps each target to its index in renderTargetPool.
+	void _allocateRenderTargets(
+			const Array< uint8_t >& _order,
+			AssocArray< CGSRenderTargetHandle, size_t >& _assignments );
+	
+	// Releases pooled textures no target has used for
+	// RENDER_TARGET_POOL_KEEP_FRAMES frames.
+	void _trimRenderTargetPool( );
+	
+	// Back-end of both render( ) overloads.
+	void _renderStages( const Array< uint8_t >& _order );
+	
+	// (Re)creates the render target and backbuffer textures in _internalFormat.
+	// On failure, the current textures are kept.
+	bool _createFramebufferTextures( const GLenum& _internalFormat );
+	
+	// Brings the backbuffer up to date with the render target and binds it to
+	// _unit, according to backbufferStrategy.
+	// Only _region is copied, if it is known.
+	void _pullBackbuffer(
+			const uint8_t& _unit,
+			const CGSScreenRegion& _region = CGSScreenRegion( ) );
+	
+	// Returns the index one past the last command which can be drawn in one
+	// multi-draw with the command at _start, whose instance run ends at
+	// _runEnd. Returns _runEnd if no other runs can be included.
+	size_t _findMultiDrawEnd(
+			CGSRenderStage& _stage,
+			const size_t& _start,
+			const size_t& _runEnd );
+	
+	// Draws _mesh after its occlusion proxy, inside a conditional render on the
+	// proxy's query from the frame before, as planOcclusionDraw( ) decides.
+	// _depthWrites is the depth mask state, which is restored after the proxy.
+	void _renderOcclusionTested(
+			CGSMesh* const& _mesh,
+			const GLsizei& _instanceCount,
+			const GLintptr& _instanceBufferOffset,
+			const bool& _depthWrites );
+	
+	// Draws the commands [ _start, _end ) of _stage with one multi-draw call.
+	void _renderMultiDraw(
+			CGSRenderStage& _stage,
+			const size_t& _start,
+			const size_t& _end,
+			const size_t& _instanceDataBase );
+	
+	CGSStateCache stateCache;
+	CGSFrameSync frameSync;
+	
+	// Presentation. See setPresentMode( ), setFrameLimit( ) and
+	// getFrameLatency( ).
+	PresentMode presentMode;
+	float frameLimit;
+	std::chrono::steady_clock::duration frameInterval; // Zero without a limit
+	std::chrono::steady_clock::time_point nextFrameTime;
+	std::function< void( ) > lateLatchCallback;
+	bool frameStarted; // waitForFrameStart( ) was called for the next frame
+	
+	// A GL_TIMESTAMP query is issued after the swap of each frame, per frame
+	// slot, and read back once the slot comes around again, when the frame is
+	// complete and the result is ready without waiting. The GL time each frame
+	// started is kept with its query.
+	GLint64 frameStartTime;
+	GLuint latencyQueries[ CGSFrameSync::MAX_FRAMES_IN_FLIGHT ];
+	GLint64 latencyFrameStarts[ CGSFrameSync::MAX_FRAMES_IN_FLIGHT ];
+	bool latencyQueriesPending[ CGSFrameSync::MAX_FRAMES_IN_FLIGHT ];
+	double frameLatency;
+	
+	// Called by render( ) before the render graph is built. Starts the frame if
+	// needed, then calls the late-latch callback.
+	void _startFrame( );
+	
+	// Reads the latency and GPU time queries of the current frame slot, if they
+	// are ready, then adjusts the resolution scale from the GPU time.
+	void _readFrameQueries( );
+	
+	// Dynamic resolution. See setResolutionScale( ) and setDynamicResolution( ).
+	// renderX and renderY are the size of the part of the screen target
+	// rendered to at the current scale. GPU time queries are kept per frame
+	// slot, as the latency queries are.
+	float resolutionScale;
+	float resolutionBudget; // Milliseconds; 0 without dynamic resolution
+	float minimumResolutionScale;
+	uint16_t renderX;
+	uint16_t renderY;
+	GLuint gpuTimeQueries[ CGSFrameSync::MAX_FRAMES_IN_FLIGHT ];
+	bool gpuTimeQueriesPending[ CGSFrameSync::MAX_FRAMES_IN_FLIGHT ];
+	double gpuFrameTime;
+	
+	// Compositor meshes are given cgsResolutionScale. Its location is kept
+	// with the program and link it was found in, since relinking may move it.
+	struct CompositorUniforms
+	{
+		GLuint program;
+		uint32_t linkCount;
+		GLint resolutionScaleLocation;
+	};
+	UnorderedAssocArray< CGSMesh*, CompositorUniforms > compositorMeshes;
+	
+	// Converts _region from window pixels to pixels of a target rendered at
+	// the current scale, rounding outwards. An unknown region stays unknown.
+	CGSScreenRegion _scaleRegion( const CGSScreenRegion& _region ) const;
+	
+	// Moves the scale of dynamic resolution towards the budget after a new GPU
+	// time is read.
+	void _updateDynamicResolution( );
+	
+	// Damage tracking. See setDamageTracking( ). damage is meaningful while
+	// damaged is set, and is unknown if the whole screen is damaged. lastOrder
+	// is the order of the stages rendered by the last frame.
+	bool damageTracking;
+	bool damaged;
+	CGSScreenRegion damage;
+	CGSScreenRegion lastDamage;
+	bool frameSkipped;
+	Array< uint8_t > lastOrder;
+	
+	// Collects the damage of this frame from the stages in _order, into
+	// lastDamage, and resets it for the next frame. Returns false if nothing
+	// was damaged, so the frame can be skipped.
+	bool _findDamage( const Array< uint8_t >& _order );
+	
 	OrderedSet< String > shaderSearchPaths;
 	AssocArray< Pair< ShaderType, String >, CGSShader* > loadedShaders;
 	AssocArray< uint32_t, CGSMesh* > meshes;
+	AssocArray< GLuint, uint32_t > sharedProgramUsers; // Users beyond the first
 	UnorderedSet< CGSTexture* > textures;
 	
+	// Objects changed since the last frame. See _queueMeshUpdate( ).
+	UnorderedSet< CGSMesh* > meshUpdateQueue;
+	UnorderedSet< CGSTexture* > textureUpdateQueue;
+	
 	// This is a secondary indexing of textures, for textures which represent
 	// image files. The existence of a texture pointer in this structure does NOT
 	// mean the pointer is valid. Entries are not removed from textureFilesByPath
@@ -291,6 +1253,9 @@ protected:
 	
 	bool inititalized;
 	
+	GLint glMajorVersion;
+	GLint glMinorVersion;
+	
 	// Shader loading functions
 	String _generateShaderFileName( const ShaderType& _type, const String& _name );
 	CGSShader* _loadShader( const ShaderType& _type, const String& _path );
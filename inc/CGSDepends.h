@@ -47,6 +47,8 @@
 #include <utility>
 #include <random>
 #include <chrono>
+#include <functional>
+#include <memory>
 #include <vector>
 #include <algorithm>
 #include <typeinfo>
@@ -96,6 +98,7 @@ class CGSTexture;
 class CGSStandardTexture;
 class CGSRectangleTexture;
 class CGSMeshToTextureAdapter;
+class CGSMultiDrawPool;
 enum class TextureType : uint8_t;
 enum class TextureDimensionality : GLenum;
 enum class TextureFormat : GLenum;
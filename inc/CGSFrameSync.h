@@ -0,0 +1,111 @@
+/*	Copyright (c) 2015-2016 William Kappler
+
+	Permission to use, copy, modify, and/or distribute this software for any
+	purpose with or without fee is hereby granted, provided that the above
+	copyright notice and this permission notice appear in all copies.
+
+	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+	REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+	AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+	INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+	LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+	OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+	PERFORMANCE OF THIS SOFTWARE. */
+
+#ifndef CGSFRAMESYNC_H
+#define	CGSFRAMESYNC_H
+
+#include "CGSDepends.h"
+
+// Tracks which frames the GPU has finished, so that resources used by a frame
+// can be reused or deleted without stalling. There is one instance, owned by
+// the GraphicsSystem; get it with GraphicsSystem::getFrameSync( ).
+//
+// render( ) places a fence at the end of every frame. The CPU may record up to
+// getFramesInFlight( ) frames before the GPU has finished the oldest; render( )
+// only waits when it gets further ahead than that. Resources which are
+// rewritten every frame can be kept once per frame in flight, selected with
+// getFrameSlot( ): by the time a slot comes around again, the GPU is done with
+// what the previous frame in that slot wrote.
+class CGSFrameSync
+{
+public:
+	const static uint8_t MAX_FRAMES_IN_FLIGHT = 3;
+	const static uint8_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+
+	CGSFrameSync( );
+
+	// Waits for every frame in flight, then changes how many there may be,
+	// clamped to [ 1, MAX_FRAMES_IN_FLIGHT ]. With 1, every frame waits for the
+	// one before it, which gives the lowest latency at the cost of throughput.
+	void setFramesInFlight( const uint8_t& _frames );
+	inline uint8_t getFramesInFlight( ) const { return framesInFlight; }
+
+	// The number of the frame being recorded, counting from 0. Remember it when
+	// writing a resource the GPU will read, and pass it to isFrameComplete( )
+	// before writing the resource again.
+	inline uint64_t getFrameNumber( ) const { return frameNumber; }
+
+	// Which set of per-frame resources the frame being recorded should use,
+	// from 0 to getFramesInFlight( ) - 1.
+	inline uint8_t getFrameSlot( ) const { return slot; }
+
+	// True if the GPU finished every command of frame _frame, so anything it
+	// used may be overwritten. Never waits. The frame being recorded, and any
+	// later one, is never complete.
+	bool isFrameComplete( const uint64_t& _frame );
+
+	// Blocks until isFrameComplete( _frame ) would be true. Waiting for the
+	// frame being recorded does nothing, as it has not been submitted.
+	void waitForFrame( const uint64_t& _frame );
+
+	// Deletes the object once the GPU has finished the frame being recorded.
+	// Use this for objects the current or a recent frame may still use.
+	void deleteBufferWhenComplete( const GLuint& _buffer );
+	void deleteTextureWhenComplete( const GLuint& _texture );
+
+	// The number of frames render( ) had to wait for the GPU before starting,
+	// since the GraphicsSystem was created. If this keeps rising, the GPU is
+	// the bottleneck.
+	inline uint64_t getStallCount( ) const { return stallCount; }
+
+	// CGS INTERNAL CALLS ========================================================
+
+	// Called at the start of render( ). Waits until the frame which last used
+	// the current slot is complete, then deletes what was queued with it.
+	void _beginFrame( );
+
+	// Called at the end of render( ), after the swap. Fences the frame and moves
+	// on to the next slot.
+	void _endFrame( );
+
+	// Waits for every frame and deletes everything queued. Called while the
+	// OpenGL context still exists, when the GraphicsSystem is destroyed.
+	void _release( );
+
+protected:
+	struct Frame
+	{
+		GLsync fence; // NULL once the frame is known to be complete
+		uint64_t number;
+		Array< GLuint > buffers;
+		Array< GLuint > textures;
+	};
+
+	Frame frames[ MAX_FRAMES_IN_FLIGHT ];
+	uint8_t framesInFlight;
+	uint8_t slot;
+	uint64_t frameNumber;
+	uint64_t completedFrames; // Every frame before this one is complete
+	uint64_t stallCount;
+
+	// Marks the frame in _frame as complete and deletes what was queued with it.
+	// Its fence must have been signaled.
+	void _retire( Frame& _frame );
+
+	// Blocks until _fence is signaled.
+	void _waitForFence( const GLsync& _fence );
+};
+
+#endif	/* CGSFRAMESYNC_H */
+
@@ -13,17 +13,12 @@
 	PERFORMANCE OF THIS SOFTWARE. */
 
 // TODO:
-// * Add the ability to write to only specific locations in a stream (ie, don't
-// require writing the whole stream to beginning to end; allow the internal 
-// pointer to be overridden, like with indexes).
-// * Only re-upload data streams that have been changed?
 // * In the future, there will only be one stream, one stream to rule them all,
 // which is broken up into virtual streams. Each mesh will just get a block of 
 // that stream to work with. Ogre2 does this. However, that may or may not take 
 // forever to implement, especially since performance with this system is likely 
 // to already be substantially better than Ogre1, enough that the fragment shaders
 // are likely going to be the bottleneck well beyond everything else involved.
-// * Ability to non-destructively resize the stream. Perhaps silently.
 
 // Uncomment this to prevent errors from being reported by calls to the
 // programUniform*( ) functions which attempt to set locations that do not exist.
@@ -37,6 +32,9 @@
 #define MESH_H
 
 #include "CGS.h"
+#include "CGSVertexLayout.h"
+#include "CGSStreamUtility.h"
+#include "CGSOcclusionPlan.h"
 
 class CGSMesh
 {
@@ -52,12 +50,14 @@ public:
 	// precision floats (GLSL requires those to be named as such). Float, half
 	// float, and normalized integers are valid. Any other type could result in
 	// unexpected behavior or crashes.
-	static const GLuint VERTEX_BINDING_POINT_POSITION; // = 0
-	static const GLuint VERTEX_BINDING_POINT_UVW; // = 1
-	static const GLuint VERTEX_BINDING_POINT_COLOR; // = 2
-	static const GLuint VERTEX_BINDING_POINT_NORMAL; // = 3
-	static const GLuint VERTEX_BINDING_POINT_FIRST_USER; // = 4
+	static const GLuint VERTEX_BINDING_POINT_POSITION = 0;
+	static const GLuint VERTEX_BINDING_POINT_UVW = 1;
+	static const GLuint VERTEX_BINDING_POINT_COLOR = 2;
+	static const GLuint VERTEX_BINDING_POINT_NORMAL = 3;
+	static const GLuint VERTEX_BINDING_POINT_FIRST_USER = 4;
 	// Further user-defined should be ( VERTEX_BINDING_POINT_FIRST_USER + n )
+	// The values are given here so they can be used as CGSVertexAttribute
+	// indexes.
 
 	CGSMesh( const GLenum& _renderOperation = GL_POINTS );
 	~CGSMesh( );
@@ -67,13 +67,76 @@ public:
 
 	// Sets the render operation to use when calling glDrawArrays( ). See the docs
 	// of that for details. This does NOT modify the stream, so changing it has no
-	// overhead. Default is GL_POINTS.
+	// overhead beyond damaging the mesh (see markDamaged( )). Default is
+	// GL_POINTS.
 	// https://www.opengl.org/sdk/docs/man/html/glDrawArrays.xhtml
 	void setRenderOperation( const GLenum& mode );
 
-	inline void setVisibility( const bool& _visibility ) { visible = _visibility; }
+	void setVisibility( const bool& _visibility );
 	inline bool getVisibility( ) { return visible; }
 	
+	// The region of the screen the mesh covers, in pixels. Backbuffer pulls use
+	// it to copy only what operations on this mesh can read; see
+	// CGSRenderStage::insertOperation( ). Damage tracking uses it to redraw only
+	// what a change to the mesh affects; see GraphicsSystem::setDamageTracking( ).
+	// CGS does not know where a mesh ends up on screen, so keep this up to date
+	// if it moves. Unknown by default, which makes pulls copy, and changes
+	// redraw, the whole screen.
+	void setScreenBounds( const CGSScreenRegion& _bounds );
+	inline const CGSScreenRegion& getScreenBounds( ) const { return screenBounds; }
+	
+	// Damages the screen bounds of the mesh, so the next frame redraws them
+	// with damage tracking. CGS does this itself for changes made through the
+	// mesh; call it after changing what the mesh draws any other way. Also
+	// invalidates cached stages drawing the mesh (see
+	// CGSRenderStage::setCacheable( )).
+	void markDamaged( );
+	
+	// Counts the changes to how the mesh looks, as reported by markDamaged( )
+	// and setVisibility( ). Cached stages compare it between frames.
+	inline uint32_t _getChangeCount( ) const { return changeCount; }
+	
+	// OCCLUSION TESTING =========================================================
+	
+	// Makes the mesh occlusion tested. Each frame, before the mesh is drawn,
+	// _proxy is drawn inside an occlusion query with color and depth writes
+	// off, and the mesh is only drawn if the proxy passed the depth test the
+	// frame before. Use a cheap stand-in covering the mesh, like its bounding
+	// box, for expensive meshes which are often hidden behind opaque ones
+	// drawn earlier. A hidden mesh takes a frame to reappear once uncovered;
+	// with damage tracking, a frame drawing the mesh conditionally damages it
+	// so that frame is always rendered (see planOcclusionDraw( )).
+	//
+	// The proxy is given the instance data of the operations on the mesh, so it
+	// needs the same instance attributes, and must be kept in place with the
+	// mesh. It must be visible, but need not be in any render stage. Testing
+	// needs a depth buffer (see GraphicsSystem::setDepthFormat( )); without
+	// one, the mesh is always drawn. Only the first operation on the mesh in a
+	// frame is tested, and its result applies to the rest. Frames which only
+	// redraw damage (see GraphicsSystem::setDamageTracking( )) are not tested,
+	// and neither are cacheable stages (see CGSRenderStage::setCacheable( )),
+	// whose cache would keep a mesh hidden for as long as it is reused.
+	// Occlusion tested meshes are never part of a multi-draw.
+	//
+	// NULL, the default, turns testing off.
+	void setOcclusionProxy( CGSMesh* const& _proxy );
+	inline CGSMesh* getOcclusionProxy( ) const { return occlusionProxy; }
+	
+	// The occlusion query issued for frame _frame, or 0 if there was none.
+	GLuint _getOcclusionQuery( const uint64_t& _frame ) const;
+	
+	// Returns the query to issue for frame _frame, which _getOcclusionQuery( )
+	// returns from then on. There are two, used in turn, so the query of the
+	// frame before is kept while the next is issued.
+	GLuint _startOcclusionQuery( const uint64_t& _frame );
+	
+	// Whether the mesh was drawn conditionally on its query in frame _frame.
+	inline bool _wasDrawnConditionally( const uint64_t& _frame ) const
+	{
+		return occlusionConditionalFrame == _frame;
+	}
+	inline void _setDrawnConditionally( const uint64_t& _frame ) { occlusionConditionalFrame = _frame; }
+	
 	// VERTEX BUFFER OBJECT + ATTRIBUTES FUNCTIONS ===============================
 
 	// Declare a vertex attribute to attach to the mesh - including position 0, 
@@ -128,11 +191,50 @@ public:
 	// (which has 3 parameters most of the time), you will have 30 entries, in
 	// the pattern of [x1 y1 z1 x2 y2 z2...x9 y9 z9 x10 y10 z10].
 	void generateDataStream( const uint16_t& length );
+	
+	// Changes the number of vertexes in the stream, keeping those it already
+	// has, for meshes which grow and shrink often, like particles or text.
+	// Vertexes added are uninitialized until written. Room is kept for twice
+	// the vertexes needed when growing, in the stream and the vertex buffer,
+	// so steady resizing does not allocate; shrinking never frees. Without a
+	// stream to keep, or after the attributes changed, this is
+	// generateDataStream( _length ).
+	void resizeDataStream( const uint16_t& _length );
+	
+	// Use _length vertexes of data built elsewhere as the stream, in place of
+	// one made by generateDataStream( ), without copying it. The data must be
+	// laid out exactly as generateDataStream( ) would lay out the attributes:
+	// interleaved, in order of attribute index, packed (see
+	// CGSVertexLayout::getOffset( )). It is uploaded next frame, and can be
+	// written with writeToA( ) and writeVertices( ) like any stream.
+	//
+	// The mesh owns the data from then on, and frees it when the stream is
+	// replaced or the mesh is deleted: with _deleter, with delete[] for a
+	// unique_ptr, or by deleting the array, whose size gives the length. If
+	// false is returned, the data was not taken.
+	bool adoptDataStream(
+			uint8_t* const& _data,
+			const uint16_t& _length,
+			const std::function< void( uint8_t* ) >& _deleter );
+	bool adoptDataStream( std::unique_ptr< uint8_t[ ] >&& _data, const uint16_t& _length );
+	bool adoptDataStream( Array< uint8_t >&& _data );
+	
+	// Uploads _length vertexes of data laid out as for adoptDataStream( )
+	// straight from _data, which the caller keeps, and may change or free as
+	// soon as this returns. The mesh keeps no copy, so the stream cannot be
+	// written afterwards; generate or adopt a new one to change it.
+	bool borrowDataStream( const uint8_t* const& _data, const uint16_t& _length );
 
 	// Opens a vertex attribute for writing via writeToA( ). Returns true if the 
 	// attribute with attributeIndex is found and opened, false if it is not 
 	// found. Default position is the beginning of the data stream, vertex 0.
 	bool openAttribute( const GLuint& attributeIndex );
+	
+	// Moves the internal pointer of the open attribute to the first element of
+	// vertex _vertex, so only the vertexes which changed need writing. Only the
+	// vertexes written are uploaded again, not the whole stream. Returns false
+	// if no attribute is open or _vertex is past the end of the stream.
+	bool moveToA( const uint16_t& _vertex );
 
 	// Writes to the currently open vertex attribute in the current location, and 
 	// automatically increments the internal pointer. Different declarations are 
@@ -162,10 +264,77 @@ public:
 	// GL_UNSIGNED_INT
 	void writeToA( const uint32_t& d );
 	// Fixed?
+	
+	// Bulk versions of the above: write _count values read from _source, as
+	// that many single writes would, but check the attribute only once. Values
+	// are _sourceStride bytes apart in _source, or packed if it is 0, so an
+	// attribute can be read straight out of an array of structs. The values
+	// are written in order across the elements of each vertex, and nothing is
+	// written if they would run past the end of the stream.
+	void writeToA( const float* const& _source, const size_t& _count, const size_t& _sourceStride = 0 );
+	void writeToA( const double* const& _source, const size_t& _count, const size_t& _sourceStride = 0 );
+	void writeToA( const int8_t* const& _source, const size_t& _count, const size_t& _sourceStride = 0 );
+	void writeToA( const uint8_t* const& _source, const size_t& _count, const size_t& _sourceStride = 0 );
+	void writeToA( const int16_t* const& _source, const size_t& _count, const size_t& _sourceStride = 0 );
+	void writeToA( const uint16_t* const& _source, const size_t& _count, const size_t& _sourceStride = 0 );
+	void writeToA( const int32_t* const& _source, const size_t& _count, const size_t& _sourceStride = 0 );
+	void writeToA( const uint32_t* const& _source, const size_t& _count, const size_t& _sourceStride = 0 );
 
 	// Closes the currently open vertex attribute. Implicitly called by 
 	// openAttribute( ) if a vertex attribute is already open for writing.
+	// Warns if the attribute was not written to the end, unless moveToA( ) was
+	// used.
 	void closeAttribute( );
+	
+	// Replaces every vertex attribute with those of Layout, a CGSVertexLayout,
+	// in one call. As with createVertexAttribute( ), generateDataStream( ) must
+	// be called after this.
+	template< typename Layout >
+	inline void createVertexLayout( )
+	{
+		static_assert( Layout::isOrdered( ),
+				"Vertex layout attributes must be in ascending index order." );
+		_createVertexLayout( Layout::_getAttributes( ), Layout::size( ), Layout::_getTag( ) );
+	}
+	
+	// Copies _count whole vertexes from _vertexes into the stream, starting at
+	// vertex _first. Vertex is a struct holding the attributes of Layout in
+	// order, with no padding, so it is copied as is. Layout must be the layout
+	// last given to createVertexLayout( ), with no attributes changed since;
+	// that and the range are checked once per call, never per vertex. Nothing
+	// is written if either check fails.
+	template< typename Layout, typename Vertex >
+	inline void writeVertices(
+			const Vertex* const& _vertexes,
+			const size_t& _count,
+			const size_t& _first = 0 )
+	{
+		static_assert( sizeof( Vertex ) == Layout::getStride( ),
+				"The vertex struct does not match the vertex layout; check it for padding." );
+		_writeVertices( _vertexes, _count, _first, Layout::_getTag( ) );
+	}
+	
+	// INSTANCE ATTRIBUTE FUNCTIONS ==============================================
+	
+	// Declares a per-instance attribute: a float vector of numberOfElements (1-4)
+	// components which is read from the instance data given to each render
+	// operation of this mesh, rather than from the stream. See the instance data
+	// overload of CGSRenderStage::insertOperation( ).
+	//
+	// Instance attributes are laid out in order of attributeIndex, so the
+	// instance data of an operation is the values of each attribute, lowest
+	// index first. attributeIndex must not also be used by a vertex attribute.
+	//
+	// Retained render stages read the instance data size when their draw list is
+	// rebuilt; reinsert operations after changing instance attributes.
+	bool createInstanceAttribute( const GLuint& attributeIndex, const GLint& numberOfElements );
+	
+	// Returns true if an instance attribute with that index existed and was
+	// deleted.
+	bool deleteInstanceAttribute( const GLuint& attributeIndex );
+	
+	// The number of floats of instance data each operation of this mesh uses.
+	inline uint8_t getInstanceDataSize( ) const { return instanceDataSize; }
 
 	// INDEX BUFFER FUNCTION =====================================================
 	
@@ -225,19 +394,88 @@ public:
 	
 	const GLuint& _getVAOHandle( ) { return vaoHandle; }
 	
+	// Turns this into a mesh with no vertex data, which draws _vertexCount
+	// vertexes with _sharedVAO bound; the vertex shader makes up the vertexes
+	// from gl_VertexID. _sharedVAO is not owned by the mesh. Vertex, index and
+	// instance data can no longer be added. Used for compositor meshes (see
+	// GraphicsSystem::createCompositorMesh( )).
+	void _makeAttributeless( const GLuint& _sharedVAO, const uint16_t& _vertexCount );
+	inline bool _isAttributeless( ) const { return attributeless; }
+	
+	const GLuint& _getVertexBufferHandle( ) { return vertexDataBufferHandle; }
+	const GLuint& _getIndexBufferHandle( ) { return indexBufferHandle; }
+	inline GLenum _getRenderOperation( ) const { return renderOperation; }
+	inline bool _usesIndexes( ) const { return useIndexes; }
+	
+	// The number of vertexes in the stream and indexes in the index buffer as
+	// last uploaded to OpenGL.
+	inline GLuint _getVertexCount( ) const { return uploadedVertexCount; }
+	inline GLuint _getIndexCount( ) const { return uploadedIndexCount; }
+	inline GLuint _getStreamStride( ) const { return calculatedStreamStride; }
+	
+	// Incremented every time _update( ) uploads vertex or index data, so copies
+	// of the data elsewhere can tell when they are out of date.
+	inline uint32_t _getUploadCount( ) const { return uploadCount; }
+	
+	// Describes the vertex and instance attribute layout of the mesh. Meshes
+	// with equal keys can read each other's streams with the same VAO setup.
+	// Empty if the stream is not valid.
+	inline const String& _getVertexFormatKey( ) const { return vertexFormatKey; }
+	
+	// True if _other can be drawn in the same multi-draw as this mesh: same
+	// program, vertex format, render operation and textures. See
+	// GraphicsSystem::setMultiDrawIndirect( ).
+	bool _canMultiDrawWith( CGSMesh* const& _other );
+	
+	// A small value identifying the set of textures attached to this mesh. Meshes
+	// with the same textures on the same units share a key; different sets will
+	// usually, but are not guaranteed to, have different keys. Used to group
+	// render operations by state.
+	inline uint16_t _getTextureSetKey( ) const { return textureSetKey; }
+	
 	// Implicitly called by render( ), unless called earlier. Should be called
 	// before rendering on all meshes, as calling implicitly causes latency while
-	// rendering.
+	// rendering. render( ) only calls it on meshes that were changed since their
+	// last update (see _queueUpdate( )).
 	void _update( );
 	
-	// Binds/un and draws with attached assets (programs, etc.).
-	void _render( );
+	inline bool _needsUpdate( ) const
+	{
+		return steamUpdated || !linked || ( useIndexes && indexesUpdated );
+	}
+	
+	// Binds and draws with attached assets (programs, etc.). Draws
+	// _instanceCount instances; if the mesh has instance attributes, they are
+	// read from _instanceBuffer starting at _instanceBufferOffset bytes.
+	void _render(
+			const GLsizei& _instanceCount = 1,
+			const GLuint& _instanceBuffer = 0,
+			const GLintptr& _instanceBufferOffset = 0 );
+	
+	// Pieces of _update( ) and _render( ), also used to draw the mesh from a
+	// CGSMultiDrawPool. Each expects the target VAO to be bound already.
+	// _setVertexAttributePointers( ) reads from whatever is bound to
+	// GL_ARRAY_BUFFER; _setInstanceAttributePointers( ) binds _instanceBuffer.
+	void _setVertexAttributePointers( );
+	void _setInstanceAttributePointers(
+			const GLuint& _instanceBuffer,
+			const GLintptr& _instanceBufferOffset );
+	void _bindTextures( );
 	
 	// PROGRAM FUNCTIONS =========================================================
 	// If forceLink is true, the returned handle will be linked and up to date.
 	// Otherwise, there is no guarantee that it is.
 	const GLuint& _getProgramHandle( const bool& forceLink = false );
 	
+	// Counts successful links of the program. Uniform locations found in one
+	// link may be different in the next.
+	inline uint32_t _getLinkCount( ) const { return linkCount; }
+	
+	// As _getProgramHandle( true ), for the programUniform*( ) functions. Also
+	// damages what the uniforms change: this mesh, or the whole screen if the
+	// program is shared with other meshes.
+	const GLuint& _getUniformProgramHandle( );
+	
 	// These will, with the help of GraphicsSystem, attempt to get a copy of the
 	// shader specified in _fileName. Note that all shader paths are searched for
 	// this name, and that the engine default extension will be added to each 
@@ -256,6 +494,17 @@ public:
 	bool loadFragmentShader( const String& _fileName );
 	bool loadGeometryShader( const String& _fileName );
 	
+	// Makes this mesh use the program of _source, rather than its own. Uniforms
+	// are then shared too: setting one on either mesh sets it for both. Meshes
+	// sharing a program can be drawn together when multi-draw indirect is
+	// enabled (see GraphicsSystem::setMultiDrawIndirect( )); per-mesh values
+	// should then come from instance attributes instead of uniforms.
+	//
+	// Changing the shaders of a mesh, or calling bindAttributeLocation( ) on it,
+	// gives it its own program again, with none of the shared uniform values.
+	// Returns false if _source is NULL or this mesh.
+	bool shareProgram( CGSMesh* const& _source );
+	
 	// Alternative to the above, if you have a pre-existing shader you'd like to
 	// pass.
 	bool attachVertexShader( CGSShader* const& _shader );
@@ -539,13 +788,48 @@ protected:
 	GLenum renderOperation; // Operation passed to glDrawArrays( )
 	
 	bool visible; // If true, draws when _render( ) is called
+	bool attributeless; // See _makeAttributeless( )
+	
+	// Set while the mesh is in the update queue of the GraphicsSystem, so that
+	// repeated writes in one frame only queue it once.
+	bool queuedForUpdate;
+	
+	uint32_t changeCount; // See _getChangeCount( )
+	
+	// See setOcclusionProxy( ). Queries are created on first use, and the
+	// frames they were issued for start out as UINT64_MAX.
+	CGSMesh* occlusionProxy;
+	GLuint occlusionQueries[ 2 ];
+	uint64_t occlusionQueryFrames[ 2 ];
+	uint64_t occlusionConditionalFrame;
+	
+	// Puts the mesh in the queue of meshes render( ) updates. Called by every
+	// function that makes _needsUpdate( ) true.
+	void _queueUpdate( );
+	CGSScreenRegion screenBounds; // See setScreenBounds( )
 	bool steamIsValid; // If false, generateDataStream( ) is needed
 	bool steamUpdated; // If true, the stream will be uploaded before binding
 	
+	// Byte ranges of the stream written since the last upload, for _update( )
+	// to upload alone. Unused while streamNeedsFullUpload is set, as when the
+	// stream was just made, since then everything goes.
+	CGSStreamDirtyRanges dirtyRanges;
+	bool streamNeedsFullUpload;
+	
+	// Adds [ _begin, _end ) to dirtyRanges, merging it with ranges near it,
+	// and queues the upload.
+	void _markStreamDirty( const size_t& _begin, const size_t& _end );
+	
+	// Uploads dirtyRanges with glBufferSubData( ), or the whole stream if
+	// that is needed or most of it is dirty anyway.
+	void _uploadDirtyRanges( );
+	
 	GLuint calculatedStreamStride; // Length of vertex data blocks (vertexes)
 
 	GLuint openAttributeIndex; // Index of the attr in use, -1 if none.
-	uint16_t openAttributePosition; // The "Internal pointer" starting at 0.
+	uint32_t openAttributePosition; // The "Internal pointer" starting at 0.
+	uint16_t openAttributeFirstVertex; // First vertex written since opening or moveToA( )
+	bool openAttributeMoved; // If true, moveToA( ) was used since opening
 	GLenum openAttributeType; // A copy of "type" for the open attr [optimization]
 	GLint openAttributeNumberOfElements; // Copy of numberOfElements [optimization]
 	uint8_t openAttributeStride; // The spacing BETWEEN the open elements [optimization]
@@ -554,6 +838,10 @@ protected:
 	// Attribute definitions
 	// < bound attr index, vertex attr data >
 	AssocArray< GLuint, VertexAttributeData > attributeDefinitions;
+	
+	// The CGSVertexLayout tag the attributes were created from, or NULL if
+	// they were created one by one. See createVertexLayout( ).
+	const void* vertexLayoutTag;
 
 	// Raw bytes of data to stream to the GPU - needs cast for any operations
 	// NULL if no stream is allocated. Number of chars is equal to:
@@ -561,6 +849,46 @@ protected:
 	uint8_t* stream;
 	uint16_t streamLength; // Number of elements available in the stream
 	
+	// Vertexes the stream and vertex buffer have room for; at least
+	// streamLength and the uploaded count. See resizeDataStream( ).
+	uint32_t streamCapacity;
+	uint32_t bufferCapacity;
+	
+	// Frees an adopted stream. Empty if the mesh allocated the stream itself,
+	// with new[].
+	std::function< void( uint8_t* ) > streamDeleter;
+	
+	// Computes calculatedStreamStride and the stream offsets of the
+	// attributes. The stride is 0 if there are no attributes.
+	void _layoutStream( );
+	
+	// Makes a newly set stream valid and queues its upload.
+	void _startStream( );
+	
+	// Frees the stream, however it was made, and sets it to NULL.
+	void _releaseStream( );
+	
+	// Uploads streamLength vertexes from _data to the vertex buffer, and points
+	// the attributes at it.
+	void _uploadStream( const uint8_t* const& _data );
+	
+	// Instance attribute definitions
+	// < bound attr index, < number of elements, offset in floats > >
+	AssocArray< GLuint, Pair< GLint, uint8_t > > instanceAttributes;
+	uint8_t instanceDataSize; // Sum of all instance attribute elements
+	
+	// Recalculates the instance attribute offsets and instanceDataSize.
+	void _layoutInstanceAttributes( );
+	
+	uint32_t uploadCount; // See _getUploadCount( )
+	GLuint uploadedVertexCount;
+	GLuint uploadedIndexCount;
+	String vertexFormatKey; // See _getVertexFormatKey( )
+	
+	// Rebuilds vertexFormatKey. Called whenever the stream or instance
+	// attributes are laid out.
+	void _updateVertexFormatKey( );
+	
 	// Index data, if used
 	bool useIndexes;
 	bool indexesUpdated;
@@ -574,23 +902,57 @@ protected:
 	// a pointer. This is to ease cleanup, but requires careful calling
 	// conventions in order to not create or destroy objects incorrectly.
 	AssocArray< uint8_t, CGSMeshToTextureAdapter > textures;
+	uint16_t textureSetKey; // See _getTextureSetKey( )
+	
+	// Recalculates textureSetKey. Called whenever the attached textures change.
+	void _updateTextureSetKey( );
 	
 	// PROTECTED MESH FUNCTIONS ==================================================
 	
 	// Uses the variables for the currently open attribute
 	void* _getDataLocationPointer( );
 	
+	// Marks the vertexes written to the open attribute since it was opened or
+	// moved as dirty.
+	void _flushAttributeWrites( );
+	
 	// Checks that a valid attr (!= -1) is open and the types match
 	bool _checkOpenAttribute( const GLenum& _functionType );
 	
+	// Back-ends for createVertexLayout( ) and writeVertices( ).
+	void _createVertexLayout(
+			const CGSVertexAttributeInfo* const& _attributes,
+			const size_t& _count,
+			const void* const& _layoutTag );
+	void _writeVertices(
+			const void* const& _vertexes,
+			const size_t& _count,
+			const size_t& _first,
+			const void* const& _layoutTag );
+	
 	// Back-end for writeToA( )
 	void _writeToABackend( const void* const& dP, const GLenum& _type );
 	
+	// Back-end for the bulk writeToA( ) overloads. Each value is stored in the
+	// stream by Store, which converts it to _type if needed.
+	template< typename T, void (*Store)( uint8_t* const&, const T& ) >
+	void _writeToABackend(
+			const T* const& _source,
+			const size_t& _count,
+			const size_t& _sourceStride,
+			const GLenum& _type );
+	
 	// PROGRAM VARIABLES =========================================================
 	
 	GLuint programHandle;
 	
 	bool linked;
+	uint32_t linkCount;
+	
+	// If the program is shared with other meshes, replaces it with a new,
+	// unlinked program used by this mesh alone. Called before anything that
+	// changes the program.
+	void _unshareProgram( );
 	
 	CGSShader* vertexShader;
 	CGSShader* fragmentShader;
@@ -26,6 +26,7 @@ public:
 	
 	inline uint8_t getTextureUnit( ) { return unit; }
 	inline GLuint getProgramHandle( ) { return mesh->_getProgramHandle( true ); }
+	inline CGSMesh* getMesh( ) { return mesh; }
 	
 	inline bool isValid( ) { return texture; }
 	inline CGSTexture* getTexture( ) { return texture; }
@@ -0,0 +1,96 @@
+/*	Copyright (c) 2015-2016 William Kappler
+
+	Permission to use, copy, modify, and/or distribute this software for any
+	purpose with or without fee is hereby granted, provided that the above
+	copyright notice and this permission notice appear in all copies.
+
+	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+	REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+	AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+	INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+	LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+	OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+	PERFORMANCE OF THIS SOFTWARE. */
+
+#ifndef CGSMULTIDRAWPOOL_H
+#define	CGSMULTIDRAWPOOL_H
+
+#include "CGS.h"
+
+// Holds copies of the vertex and index data of every mesh of one vertex format
+// (see CGSMesh::_getVertexFormatKey( )) in a single pair of buffers, with one
+// VAO reading them. A multi-draw indirect call can only use one VAO, so this is
+// what lets operations on different meshes be drawn by one call; each draw
+// then picks out its mesh with baseVertex and firstIndex.
+//
+// Meshes keep their own buffers, which remain the source of the data. The pool
+// copies from them on the GPU with glCopyBufferSubData( ) whenever a mesh has
+// uploaded new data since it was last copied, so nothing is read back.
+//
+// Pools are created and owned by the GraphicsSystem; there is no need to use
+// this class directly.
+class CGSMultiDrawPool
+{
+public:
+	// Where a mesh lives in the pool, in vertexes and indexes.
+	struct Slot
+	{
+		GLuint firstVertex;
+		GLuint vertexCapacity;
+		GLuint firstIndex;
+		GLuint indexCapacity;
+		uint32_t uploadCount; // CGSMesh::_getUploadCount( ) when copied
+	};
+
+	// _formatSource is any mesh with the vertex format of the pool; its
+	// attribute layout is used to set up the VAO.
+	CGSMultiDrawPool( CGSMesh* const& _formatSource );
+	~CGSMultiDrawPool( );
+
+	// Makes sure the current data of _mesh is in the pool, copying it in if it
+	// is missing or out of date. May move every other mesh in the pool, so
+	// only call _getSlot( ) once all meshes of a draw are prepared.
+	void _prepareMesh( CGSMesh* const& _mesh );
+
+	// Only valid for meshes passed to _prepareMesh( ).
+	inline const Slot& _getSlot( CGSMesh* const& _mesh ) const
+	{
+		return slots.find( _mesh )->second;
+	}
+
+	// Forgets _mesh. Its space is reclaimed the next time the pool grows.
+	void _removeMesh( CGSMesh* const& _mesh );
+
+	inline const GLuint& _getVAOHandle( ) const { return vaoHandle; }
+
+protected:
+	// Space for at least this many vertexes and indexes is allocated.
+	const static GLuint MINIMUM_CAPACITY; // = 1024
+
+	GLuint vaoHandle;
+	GLuint vertexBufferHandle;
+	GLuint indexBufferHandle;
+	String formatKey;
+	GLuint stride;
+
+	GLuint vertexCapacity;
+	GLuint vertexUsed;
+	GLuint indexCapacity;
+	GLuint indexUsed;
+
+	// One mesh is kept to set the attribute layout up again after growing.
+	CGSMesh* formatSource;
+
+	UnorderedAssocArray< CGSMesh*, Slot > slots;
+
+	// Reallocates the buffers with room for every mesh plus _extraVertexes and
+	// _extraIndexes, then copies every mesh in again, packed from the start.
+	// This is also what reclaims the space of removed or moved meshes.
+	void _grow( const GLuint& _extraVertexes, const GLuint& _extraIndexes );
+
+	// Copies the data of _mesh into _slot, which must be large enough.
+	void _copyMesh( CGSMesh* const& _mesh, Slot& _slot );
+};
+
+#endif	/* CGSMULTIDRAWPOOL_H */
+
@@ -0,0 +1,52 @@
+/*	Copyright (c) 2015-2016 William Kappler
+
+	Permission to use, copy, modify, and/or distribute this software for any
+	purpose with or without fee is hereby granted, provided that the above
+	copyright notice and this permission notice appear in all copies.
+
+	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+	REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+	AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+	INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+	LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+	OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+	PERFORMANCE OF THIS SOFTWARE. */
+
+#ifndef CGSOCCLUSIONPLAN_H
+#define	CGSOCCLUSIONPLAN_H
+
+// How an occlusion tested mesh is drawn in a frame which tests it; see
+// CGSMesh::setOcclusionProxy( ). Needs no OpenGL, so it can be checked on its
+// own; see bench/.
+struct CGSOcclusionPlan
+{
+	// Drawn only if the proxy passed the depth test in the frame before.
+	bool conditional;
+
+	// The mesh's bounds must be damaged for the next frame. CGS cannot tell
+	// whether a conditional draw happened, so with damage tracking, a mesh it
+	// hid would otherwise stay hidden once uncovered until something else
+	// damaged it: the frame which would show it may have nothing to redraw.
+	bool damageNextFrame;
+};
+
+// Plans the first draw of an occlusion tested mesh in a frame. _previousQuery
+// is whether the frame before queried its proxy, and _previousConditional
+// whether that frame drew it conditionally.
+//
+// With damage tracking, a mesh drawn conditionally damages itself, and is
+// drawn unconditionally (but still queried) the frame after, which damages
+// nothing. So however many frames are whole, a frame which changes nothing
+// is reached, and the mesh is then on screen if it is not covered.
+inline CGSOcclusionPlan planOcclusionDraw(
+		const bool& _previousQuery,
+		const bool& _previousConditional,
+		const bool& _damageTracking )
+{
+	CGSOcclusionPlan plan;
+	plan.conditional = _previousQuery && !( _damageTracking && _previousConditional );
+	plan.damageNextFrame = plan.conditional && _damageTracking;
+	return plan;
+}
+
+#endif	/* CGSOCCLUSIONPLAN_H */
@@ -0,0 +1,90 @@
+/*	Copyright (c) 2015-2016 William Kappler
+
+	Permission to use, copy, modify, and/or distribute this software for any
+	purpose with or without fee is hereby granted, provided that the above
+	copyright notice and this permission notice appear in all copies.
+
+	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+	REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+	AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+	INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+	LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+	OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+	PERFORMANCE OF THIS SOFTWARE. */
+
+#ifndef CGSPOSTPROCESSCHAIN_H
+#define	CGSPOSTPROCESSCHAIN_H
+
+#include "CGS.h"
+
+// A sequence of full-screen passes (blur, bloom, color grading...), each
+// drawing one compositor mesh (see GraphicsSystem::createCompositorMesh( )) in
+// its own render stage. Every pass but the last renders to a transient render
+// target (see GraphicsSystem::createRenderTarget( )), which the next pass can
+// read; the last renders to the screen.
+//
+// Each pass reads its source through a sampler uniform named "source", which
+// is bound to the backbuffer texture unit of the pass's stage. Set any other
+// uniforms, or attach more textures, through the mesh returned by addPass( ).
+// Re-linking the program of a pass (by changing its shaders) loses the source
+// binding.
+//
+// The chain must be destroyed before the GraphicsSystem.
+class CGSPostProcessChain
+{
+public:
+	// What a pass reads as its source.
+	enum class Source : uint8_t
+	{
+		// The output of the pass before it. The first pass reads the backbuffer.
+		PREVIOUS_PASS,
+		// Everything lower indexed stages rendered to the screen.
+		BACKBUFFER
+	};
+
+	// The passes use the render stages from _firstStage up, one each, so give
+	// an index above the stages rendering the scene. Those stages are taken
+	// over: they are made retained, and their operations, output and inputs
+	// are replaced.
+	CGSPostProcessChain( const uint8_t& _firstStage );
+
+	// Deletes the meshes and render targets of every pass, and removes their
+	// render stages.
+	~CGSPostProcessChain( );
+
+	// Adds a pass after the last one, drawing a compositor mesh with
+	// _fragmentShader. The pass renders at 1/_sizeDivisor of the screen size in
+	// each dimension; 1, 2 and 4 give full, half and quarter resolution. The
+	// last pass renders to the screen, so it is always at full resolution until
+	// another pass is added after it.
+	//
+	// Returns the mesh of the pass, or NULL if it could not be created or there
+	// are no render stage indexes left.
+	CGSMesh* addPass(
+			const String& _fragmentShader,
+			const uint8_t& _sizeDivisor = 1,
+			const Source& _source = Source::PREVIOUS_PASS );
+
+	inline size_t size( ) const { return passes.size( ); }
+	inline CGSMesh* getPassMesh( const size_t& _pass ) const { return passes[ _pass ].mesh; }
+	inline uint8_t getPassStage( const size_t& _pass ) const { return firstStage + _pass; }
+
+protected:
+	struct Pass
+	{
+		CGSMesh* mesh;
+		uint8_t sizeDivisor;
+		Source source;
+		CGSRenderTargetHandle target; // 0 while the pass renders to the screen
+	};
+
+	uint8_t firstStage;
+	Array< Pass > passes;
+
+	// Sets the output and inputs of the stage of _pass from its position in the
+	// chain.
+	void _connectPass( const size_t& _pass );
+};
+
+#endif	/* CGSPOSTPROCESSCHAIN_H */
+
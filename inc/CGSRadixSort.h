@@ -0,0 +1,120 @@
+/*	Copyright (c) 2015-2016 William Kappler
+
+	Permission to use, copy, modify, and/or distribute this software for any
+	purpose with or without fee is hereby granted, provided that the above
+	copyright notice and this permission notice appear in all copies.
+
+	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+	REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+	AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+	INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+	LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+	OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+	PERFORMANCE OF THIS SOFTWARE. */
+
+#ifndef CGSRADIXSORT_H
+#define	CGSRADIXSORT_H
+
+// Needs no OpenGL, so it can be benchmarked on its own; see bench/.
+#include <stdint.h>
+#include <string.h>
+#include <utility>
+
+// Converts an ordering value to an unsigned integer which sorts identically.
+// For floats, positive values have the sign bit set and negative values have all
+// bits flipped, which reverses their (sign-magnitude) order.
+inline uint32_t _orderingToKey( const float& _position )
+{
+	// Fold -0.0 into 0.0, since they compare equal.
+	float position = ( _position == 0.0f ) ? 0.0f : _position;
+	
+	uint32_t bits;
+	memcpy( &bits, &position, sizeof( bits ) );
+	
+	return ( bits & 0x80000000 ) ? ~bits : ( bits | 0x80000000 );
+}
+
+inline uint32_t _orderingToKey( const int32_t& _position )
+{
+	return (uint32_t)_position ^ 0x80000000;
+}
+
+inline uint32_t _orderingToKey( const uint32_t& _position )
+{
+	return _position;
+}
+
+// Sorts _items, a vector of anything with a uint64_t member named key, from
+// lowest to highest key. Being stable, items with identical keys keep their
+// order. _scratch is working space, kept by the caller between sorts so that
+// steady-state sorts do not allocate; its contents are undefined afterwards.
+//
+// LSD radix sort, 8 bits per pass. All histograms are built in a single pass
+// over the keys.
+template< typename Container >
+void radixSortByKey( Container& _items, Container& _scratch )
+{
+	const size_t count = _items.size( );
+
+	if( count < 2 )
+	{
+		return;
+	}
+
+	size_t histograms[ 8 ][ 256 ];
+	memset( histograms, 0, sizeof( histograms ) );
+
+	for( size_t i = 0; i < count; ++i )
+	{
+		uint64_t key = _items[ i ].key;
+
+		for( uint8_t pass = 0; pass < 8; ++pass )
+		{
+			++histograms[ pass ][ ( key >> ( pass * 8 ) ) & 0xFF ];
+		}
+	}
+
+	_scratch.resize( count, _items.front( ) );
+
+	Container* source = &_items;
+	Container* destination = &_scratch;
+
+	for( uint8_t pass = 0; pass < 8; ++pass )
+	{
+		size_t* histogram = histograms[ pass ];
+		uint8_t shift = pass * 8;
+
+		// If every key has the same value for this digit, the pass would not move
+		// anything. This is very common for the state bits, and for the low bits of
+		// the ordering when it is a whole number.
+		if( histogram[ ( source->front( ).key >> shift ) & 0xFF ] == count )
+		{
+			continue;
+		}
+
+		// Convert the counts into starting offsets.
+		size_t offset = 0;
+		for( uint16_t digit = 0; digit < 256; ++digit )
+		{
+			size_t digitCount = histogram[ digit ];
+			histogram[ digit ] = offset;
+			offset += digitCount;
+		}
+
+		for( size_t i = 0; i < count; ++i )
+		{
+			(*destination)[ histogram[ ( (*source)[ i ].key >> shift ) & 0xFF ]++ ] = (*source)[ i ];
+		}
+
+		std::swap( source, destination );
+	}
+
+	// An odd number of passes leaves the result in the scratch buffer. Swapping
+	// the vectors keeps both allocations alive for the next sort.
+	if( source != &_items )
+	{
+		_items.swap( _scratch );
+	}
+}
+
+#endif	/* CGSRADIXSORT_H */
@@ -0,0 +1,134 @@
+/*	Copyright (c) 2015-2016 William Kappler
+
+	Permission to use, copy, modify, and/or distribute this software for any
+	purpose with or without fee is hereby granted, provided that the above
+	copyright notice and this permission notice appear in all copies.
+
+	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+	REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+	AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+	INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+	LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+	OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+	PERFORMANCE OF THIS SOFTWARE. */
+
+#ifndef CGSSTATECACHE_H
+#define	CGSSTATECACHE_H
+
+#include "CGSDepends.h"
+
+// Tracks the OpenGL binding state CGS changes while rendering and skips calls
+// which would not change anything. There is one instance, owned by the
+// GraphicsSystem; get it with GraphicsSystem::_getStateCache( ).
+//
+// The cache only knows about calls made through it. If you make OpenGL calls
+// yourself that change any of the state below (programs, VAOs, framebuffers,
+// the active texture unit or texture bindings), call invalidate( ) afterwards,
+// or CGS may skip binds that are actually needed.
+//
+// Blending is the exception. It is left to the application, which may set it
+// directly at any time outside GraphicsSystem::render( ). When CGS changes it
+// for draws of its own, it first asks OpenGL for the application's state, at
+// most once a frame, and puts that back after.
+class CGSStateCache
+{
+public:
+	// Texture units at or above this are not tracked, and binds to them are
+	// always issued. Matches the unit CGSMesh::attachTexture( ) warns at.
+	const static uint8_t MAX_TRACKED_TEXTURE_UNITS = 80;
+
+	// Everything glEnable( GL_BLEND ), glBlendFuncSeparate( ) and
+	// glBlendEquationSeparate( ) set. Constructed with OpenGL's defaults:
+	// disabled, GL_ONE, GL_ZERO and GL_FUNC_ADD. See _getBlendState( ).
+	struct BlendState
+	{
+		BlendState( );
+
+		bool operator==( const BlendState& _other ) const;
+		bool operator!=( const BlendState& _other ) const { return !( *this == _other ); }
+
+		bool enabled;
+		GLenum sourceRGB;
+		GLenum destinationRGB;
+		GLenum sourceAlpha;
+		GLenum destinationAlpha;
+		GLenum equationRGB;
+		GLenum equationAlpha;
+	};
+
+	CGSStateCache( );
+
+	void useProgram( const GLuint& _program );
+	void bindVertexArray( const GLuint& _vao );
+
+	// _target may be GL_FRAMEBUFFER, GL_DRAW_FRAMEBUFFER or GL_READ_FRAMEBUFFER,
+	// just like glBindFramebuffer( ).
+	void bindFramebuffer( const GLenum& _target, const GLuint& _framebuffer );
+
+	void activeTexture( const uint8_t& _unit );
+
+	// Makes _unit active (if needed) and binds _texture to _target on it.
+	void bindTexture( const uint8_t& _unit, const GLenum& _target, const GLuint& _texture );
+
+	// Binds _texture to _target on whichever unit is currently active. Intended
+	// for binds done to edit a texture rather than to render with it.
+	void bindTextureToActiveUnit( const GLenum& _target, const GLuint& _texture );
+
+	// Forget all cached state. The next call of each kind will be issued.
+	void invalidate( );
+
+	// The number of calls issued to and skipped before OpenGL during the last
+	// complete frame.
+	inline uint32_t getCallsIssued( ) const { return lastFrameCallsIssued; }
+	inline uint32_t getCallsSkipped( ) const { return lastFrameCallsSkipped; }
+
+	// CGS INTERNAL CALLS ========================================================
+
+	// Called at the end of render( ); stores and resets the call counters.
+	// Also forgets the blend state, which the application may change before
+	// the next frame.
+	void _endFrame( );
+
+	// The current blend state. Queried from OpenGL if it is not known, which
+	// is the case the first time it is needed each frame.
+	const BlendState& _getBlendState( );
+
+	// Issues only the calls for the parts of _state which differ from the
+	// current blend state.
+	void _setBlendState( const BlendState& _state );
+
+	// Must be called when CGS deletes an object, since deleting some objects
+	// changes the binding state, and names of deleted objects may be reused.
+	void _notifyProgramDeleted( const GLuint& _program );
+	void _notifyVertexArrayDeleted( const GLuint& _vao );
+	void _notifyFramebufferDeleted( const GLuint& _framebuffer );
+	void _notifyTextureDeleted( const GLuint& _texture );
+
+protected:
+	// Used for any binding whose current value is not known.
+	const static GLuint UNKNOWN_BINDING = (GLuint)( -1 );
+	const static uint8_t UNKNOWN_UNIT = (uint8_t)( -1 );
+
+	struct TextureBinding
+	{
+		GLenum target;
+		GLuint texture;
+	};
+
+	GLuint program;
+	GLuint vertexArray;
+	GLuint drawFramebuffer;
+	GLuint readFramebuffer;
+	uint8_t activeUnit;
+	TextureBinding textureUnits[ MAX_TRACKED_TEXTURE_UNITS ];
+	BlendState blendState;
+	bool blendStateKnown;
+
+	uint32_t callsIssued;
+	uint32_t callsSkipped;
+	uint32_t lastFrameCallsIssued;
+	uint32_t lastFrameCallsSkipped;
+};
+
+#endif	/* CGSSTATECACHE_H */
+
@@ -0,0 +1,201 @@
+/*	Copyright (c) 2015-2016 William Kappler
+
+	Permission to use, copy, modify, and/or distribute this software for any
+	purpose with or without fee is hereby granted, provided that the above
+	copyright notice and this permission notice appear in all copies.
+
+	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+	REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+	AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+	INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+	LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+	OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+	PERFORMANCE OF THIS SOFTWARE. */
+
+#ifndef CGSSTREAMUTILITY_H
+#define	CGSSTREAMUTILITY_H
+
+// The bookkeeping behind CGSMesh's interleaved vertex stream. Needs no OpenGL,
+// so it can be checked and benchmarked on its own; see bench/.
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+// Where the value at _position of an attribute lies in the stream, counting
+// values of _valueSize bytes from the first vertex, _elements to a vertex.
+// The attribute starts _offset bytes into each vertex of _stride bytes.
+inline size_t streamValueOffset(
+		const size_t& _position,
+		const size_t& _offset,
+		const size_t& _stride,
+		const size_t& _elements,
+		const size_t& _valueSize )
+{
+	return _offset
+			// Jumps between the vertex data blocks
+			+ ( _position / _elements ) * _stride
+			// Increments within the attribute itself, if multi-element
+			+ ( _position % _elements ) * _valueSize;
+}
+
+// Stores a value in the stream as it is. Values are copied bytewise, as the
+// stream has no alignment to speak of.
+template< typename T >
+inline void storeStreamValue( uint8_t* const& _destination, const T& _value )
+{
+	memcpy( _destination, &_value, sizeof( T ) );
+}
+
+// Copies _count values from _source, _sourceStride bytes apart (0 if packed),
+// into an attribute of the stream, each stored by Store in _valueSize bytes.
+// _destination is where the value at _position of the attribute lies (see
+// streamValueOffset( )). Only that needs the divide; after it, elements of a
+// vertex are packed, and the attribute of the next vertex is _skip bytes past
+// the last element, _skip being the stride less the attribute's size.
+template< typename T, void (*Store)( uint8_t* const&, const T& ) >
+void writeStreamValues(
+		uint8_t* const& _destination,
+		const T* const& _source,
+		const size_t& _count,
+		const size_t& _sourceStride,
+		const size_t& _position,
+		const size_t& _elements,
+		const size_t& _valueSize,
+		const size_t& _skip )
+{
+	const uint8_t* source = (const uint8_t*)_source;
+	size_t sourceStride = _sourceStride ? _sourceStride : sizeof( T );
+	uint8_t* destination = _destination;
+	size_t element = _position % _elements;
+
+	for( size_t i = 0; i < _count; ++i )
+	{
+		T value;
+		memcpy( &value, source, sizeof( T ) );
+		Store( destination, value );
+
+		source += sourceStride;
+		destination += _valueSize;
+
+		if( ++element == _elements )
+		{
+			element = 0;
+			destination += _skip;
+		}
+	}
+}
+
+// The capacity, in vertexes, a stream of _capacity vertexes grows to when it
+// must hold _length. Doubling keeps repeated growth amortized constant per
+// vertex; streams can never hold more than UINT16_MAX vertexes.
+inline uint32_t growStreamCapacity( const uint32_t& _capacity, const uint16_t& _length )
+{
+	return std::min( std::max( (uint32_t)_length, _capacity * 2 ), (uint32_t)UINT16_MAX );
+}
+
+// Byte ranges of a stream written since its last upload, sorted, so that only
+// they need uploading.
+class CGSStreamDirtyRanges
+{
+public:
+	// Ranges closer than this many bytes are kept as one, since a
+	// glBufferSubData( ) call costs more than re-sending a small gap.
+	const static size_t MERGE_GAP = 256;
+
+	// Past this many ranges, the two closest are merged. It bounds the
+	// glBufferSubData( ) calls of an upload while leaving room for writes
+	// scattered over a whole stream, such as 1% of its vertexes moving.
+	const static size_t MAX_RANGES = 1024;
+
+	typedef std::pair< size_t, size_t > Range;
+
+	// Adds [ _begin, _end ), merging it with ranges near it.
+	void add( const size_t& _begin, const size_t& _end )
+	{
+		// ranges is sorted and never holds ranges within the merge gap of each
+		// other, so the new range can only merge with a consecutive few.
+		size_t begin = _begin;
+		size_t end = _end;
+		auto first = ranges.begin( );
+
+		while( first != ranges.end( ) && first->second + MERGE_GAP < begin )
+		{
+			++first;
+		}
+
+		auto last = first;
+
+		while( last != ranges.end( ) && last->first <= end + MERGE_GAP )
+		{
+			begin = std::min( begin, last->first );
+			end = std::max( end, last->second );
+			++last;
+		}
+
+		first = ranges.erase( first, last );
+		ranges.insert( first, Range( begin, end ) );
+
+		// Only one range was added, so merging one pair is enough.
+		if( ranges.size( ) > MAX_RANGES )
+		{
+			size_t closest = 0;
+
+			for( size_t i = 1; i + 1 < ranges.size( ); ++i )
+			{
+				if( ranges[ i + 1 ].first - ranges[ i ].second
+						< ranges[ closest + 1 ].first - ranges[ closest ].second )
+				{
+					closest = i;
+				}
+			}
+
+			ranges[ closest ].second = ranges[ closest + 1 ].second;
+			ranges.erase( ranges.begin( ) + closest + 1 );
+		}
+	}
+
+	// Drops everything at or past _end, as when the stream is shortened.
+	void clip( const size_t& _end )
+	{
+		while( !ranges.empty( ) && ranges.back( ).first >= _end )
+		{
+			ranges.pop_back( );
+		}
+
+		if( !ranges.empty( ) )
+		{
+			ranges.back( ).second = std::min( ranges.back( ).second, _end );
+		}
+	}
+
+	inline void clear( ) { ranges.clear( ); }
+	inline const std::vector< Range >& getRanges( ) const { return ranges; }
+
+	// The number of bytes the ranges cover.
+	size_t getByteCount( ) const
+	{
+		size_t bytes = 0;
+
+		for( auto i = ranges.begin( ); i != ranges.end( ); ++i )
+		{
+			bytes += i->second - i->first;
+		}
+
+		return bytes;
+	}
+
+	// True if the ranges cover over half of a stream of _streamBytes. Past
+	// that, uploading the whole stream is cheaper, and orphans the old buffer
+	// rather than waiting for frames still reading it.
+	inline bool coversMostOf( const size_t& _streamBytes ) const
+	{
+		return getByteCount( ) * 2 > _streamBytes;
+	}
+
+protected:
+	std::vector< Range > ranges;
+};
+
+#endif	/* CGSSTREAMUTILITY_H */
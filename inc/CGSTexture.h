@@ -195,9 +195,18 @@ public:
 	// Call to invoke an update during the next render. Must be called if you
 	// edit the texture via its raw pointer via an access( ) function or
 	// from memoryStart( ). Not required if editing via CGSTextureHole.
-	inline void setModified( ) { modified = true; }
-	
-	// Uploads texture to video card if needed.
+	inline void setModified( )
+	{
+		modified = true;
+		
+		if( !queuedForUpdate )
+		{
+			_queueUpdate( );
+		}
+	}
+	
+	// Uploads texture to video card if needed. render( ) only calls this on
+	// textures modified since their last update.
 	virtual void _update( ) = 0;
 	
 	TextureDimensionality getDimensionality( ) { return dimensionality; }
@@ -407,6 +416,12 @@ protected:
 	bool modified;
 	bool storageModified;
 	
+	// Set while the texture is in the update queue of the GraphicsSystem, so
+	// that writing many texels only queues it once.
+	bool queuedForUpdate;
+	
+	void _queueUpdate( );
+	
 	uint8_t numMipMaps;
 	
 	uint8_t channelsPerTexel;
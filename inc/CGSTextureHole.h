@@ -58,11 +58,11 @@ public:
 	CGSTextureHole(
 			uint8_t* const& address,
 			const uint8_t& _channelSize,
-			bool* _textureModifiedFlag );
+			CGSTexture* const& _texture );
 #else
 	CGSTextureHole(
 			uint8_t* const& address,
-			bool* _textureModifiedFlag );
+			CGSTexture* const& _texture );
 #endif
 	
 	// If you are using this, it is probably more efficient to call the access()
@@ -102,7 +102,7 @@ public:
 	
 protected:
 	uint8_t* addressInTexture;
-	bool* textureModifiedFlag;
+	CGSTexture* texture; // Told of every write through setModified( )
 	
 #ifndef DISABLE_TEXTURE_HOLE_SIZE_CHECKS
 	uint8_t channelSize;
@@ -0,0 +1,191 @@
+/*	Copyright (c) 2015-2016 William Kappler
+
+	Permission to use, copy, modify, and/or distribute this software for any
+	purpose with or without fee is hereby granted, provided that the above
+	copyright notice and this permission notice appear in all copies.
+
+	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+	REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+	AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+	INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+	LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+	OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+	PERFORMANCE OF THIS SOFTWARE. */
+
+#ifndef CGSVERTEXLAYOUT_H
+#define	CGSVERTEXLAYOUT_H
+
+#include "CGSDepends.h"
+#include "CGSVectors.h"
+
+// Vertex formats known at compile time. Instead of a createVertexAttribute( )
+// call per attribute and a checked writeToA( ) per value, a layout names the
+// attributes once, as types:
+//
+//	using SpriteLayout = CGSVertexLayout<
+//			CGSVertexAttribute< CGSMesh::VERTEX_BINDING_POINT_POSITION, vec3 >,
+//			CGSVertexAttribute< CGSMesh::VERTEX_BINDING_POINT_UVW, vec2 >,
+//			CGSVertexAttribute< CGSMesh::VERTEX_BINDING_POINT_COLOR, CGSUNorm8x4 > >;
+//
+// CGSMesh::createVertexLayout< SpriteLayout >( ) declares all of them, and
+// CGSMesh::writeVertices< SpriteLayout >( ) then copies whole vertex structs
+// into the stream, checking the layout once per call rather than per value.
+//
+// The stream lays attributes out in order of index, packed, so attributes
+// must be given in ascending index order, and a vertex struct must hold them
+// in the same order without padding. getStride( ) and getOffset( ) can be
+// checked against the struct with static_assert. src/CGSVertexLayout.cpp
+// checks the layouts themselves the same way.
+
+// A normalized RGBA color, one byte per channel. Reads as 0 to 1 in shaders.
+struct CGSUNorm8x4
+{
+	uint8_t r, g, b, a;
+};
+
+// What each C++ type stored in a vertex is to OpenGL. Only the types below may
+// be used in a layout.
+template< typename T >
+struct CGSVertexElement;
+
+template< typename T, GLenum Type, GLint Elements, bool Normalized = false >
+struct _CGSVertexElementInfo
+{
+	typedef T Component;
+	static constexpr GLenum TYPE = Type;
+	static constexpr GLint ELEMENTS = Elements;
+	static constexpr bool NORMALIZED = Normalized;
+};
+
+template< > struct CGSVertexElement< float > : _CGSVertexElementInfo< float, GL_FLOAT, 1 > { };
+template< > struct CGSVertexElement< double > : _CGSVertexElementInfo< double, GL_DOUBLE, 1 > { };
+template< > struct CGSVertexElement< int8_t > : _CGSVertexElementInfo< int8_t, GL_BYTE, 1 > { };
+template< > struct CGSVertexElement< uint8_t > : _CGSVertexElementInfo< uint8_t, GL_UNSIGNED_BYTE, 1 > { };
+template< > struct CGSVertexElement< int16_t > : _CGSVertexElementInfo< int16_t, GL_SHORT, 1 > { };
+template< > struct CGSVertexElement< uint16_t > : _CGSVertexElementInfo< uint16_t, GL_UNSIGNED_SHORT, 1 > { };
+template< > struct CGSVertexElement< int32_t > : _CGSVertexElementInfo< int32_t, GL_INT, 1 > { };
+template< > struct CGSVertexElement< uint32_t > : _CGSVertexElementInfo< uint32_t, GL_UNSIGNED_INT, 1 > { };
+
+template< > struct CGSVertexElement< vec2 > : _CGSVertexElementInfo< float, GL_FLOAT, 2 > { };
+template< > struct CGSVertexElement< vec3 > : _CGSVertexElementInfo< float, GL_FLOAT, 3 > { };
+template< > struct CGSVertexElement< vec4 > : _CGSVertexElementInfo< float, GL_FLOAT, 4 > { };
+template< > struct CGSVertexElement< dvec2 > : _CGSVertexElementInfo< double, GL_DOUBLE, 2 > { };
+template< > struct CGSVertexElement< dvec3 > : _CGSVertexElementInfo< double, GL_DOUBLE, 3 > { };
+template< > struct CGSVertexElement< dvec4 > : _CGSVertexElementInfo< double, GL_DOUBLE, 4 > { };
+template< > struct CGSVertexElement< ivec2 > : _CGSVertexElementInfo< int32_t, GL_INT, 2 > { };
+template< > struct CGSVertexElement< ivec3 > : _CGSVertexElementInfo< int32_t, GL_INT, 3 > { };
+template< > struct CGSVertexElement< ivec4 > : _CGSVertexElementInfo< int32_t, GL_INT, 4 > { };
+template< > struct CGSVertexElement< uvec2 > : _CGSVertexElementInfo< uint32_t, GL_UNSIGNED_INT, 2 > { };
+template< > struct CGSVertexElement< uvec3 > : _CGSVertexElementInfo< uint32_t, GL_UNSIGNED_INT, 3 > { };
+template< > struct CGSVertexElement< uvec4 > : _CGSVertexElementInfo< uint32_t, GL_UNSIGNED_INT, 4 > { };
+
+template< > struct CGSVertexElement< CGSUNorm8x4 > : _CGSVertexElementInfo< uint8_t, GL_UNSIGNED_BYTE, 4, true > { };
+
+// True if T holds its elements with nothing between or after them, as the
+// stream does.
+template< typename T >
+constexpr bool isVertexElementPacked( )
+{
+	return sizeof( T ) == sizeof( typename CGSVertexElement< T >::Component ) * CGSVertexElement< T >::ELEMENTS;
+}
+
+// One attribute of a layout: a value of type T at attribute index Index. If
+// Integer is true, integer types reach the shader as integers rather than
+// being converted to float; see CGSMesh::createVertexAttribute( ).
+template< GLuint Index, typename T, bool Integer = false >
+struct CGSVertexAttribute
+{
+	typedef T Type;
+	typedef CGSVertexElement< T > Element;
+
+	static constexpr GLuint INDEX = Index;
+	static constexpr bool INTEGER = Integer;
+
+	static_assert( isVertexElementPacked< T >( ),
+			"The vertex attribute type has padding, so it does not match the stream." );
+};
+
+// The runtime description of an attribute of a layout, as
+// CGSMesh::createVertexAttribute( ) takes it.
+struct CGSVertexAttributeInfo
+{
+	GLuint index;
+	GLenum type;
+	GLint numberOfElements;
+	bool integerType;
+	GLboolean normalize;
+};
+
+// A vertex format made of CGSVertexAttribute's, in ascending index order.
+template< typename... Attributes >
+class CGSVertexLayout
+{
+public:
+	// The number of attributes.
+	static constexpr size_t size( ) { return sizeof...( Attributes ); }
+
+	// Bytes per vertex in the stream.
+	static constexpr size_t getStride( )
+	{
+		return getOffset( sizeof...( Attributes ) );
+	}
+
+	// Where attribute _attribute (counting in the order given) starts within a
+	// vertex, in bytes. Giving size( ) returns the stride.
+	static constexpr size_t getOffset( const size_t& _attribute )
+	{
+		const size_t sizes[ ] = { 0, sizeof( typename Attributes::Type )... };
+		size_t offset = 0;
+
+		for( size_t i = 1; i <= _attribute; ++i )
+		{
+			offset += sizes[ i ];
+		}
+
+		return offset;
+	}
+
+	// True if the attributes were given in ascending index order, which is
+	// how the stream lays them out.
+	static constexpr bool isOrdered( )
+	{
+		const GLuint indexes[ ] = { 0, Attributes::INDEX... };
+
+		for( size_t i = 2; i <= sizeof...( Attributes ); ++i )
+		{
+			if( indexes[ i ] <= indexes[ i - 1 ] )
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// The attributes, in order, for CGSMesh::createVertexLayout( ).
+	static const CGSVertexAttributeInfo* _getAttributes( )
+	{
+		static const CGSVertexAttributeInfo attributes[ ] = {
+			{
+				Attributes::INDEX,
+				Attributes::Element::TYPE,
+				Attributes::Element::ELEMENTS,
+				Attributes::INTEGER,
+				Attributes::Element::NORMALIZED ? (GLboolean)GL_TRUE : (GLboolean)GL_FALSE
+			}... };
+
+		return attributes;
+	}
+
+	// Identifies the layout, so a mesh can tell which one it was given. Layouts
+	// of the same attributes share one.
+	static constexpr const void* _getTag( ) { return &tag; }
+
+private:
+	static constexpr char tag = 0;
+};
+
+template< typename... Attributes >
+constexpr char CGSVertexLayout< Attributes... >::tag;
+
+#endif	/* CGSVERTEXLAYOUT_H */
@@ -16,6 +16,7 @@
 #include "CGSMesh.h"
 #include "CGSShader.h"
 #include "CGSTexture.h"
+#include "CGSMultiDrawPool.h"
 
 GraphicsSystem* GraphicsSystem::globalInstance = NULL;
 
@@ -28,6 +29,33 @@ const char* GraphicsSystem::GLSL_TESSELLATION_EVALUATION_EXTENSION = "tevl";
 const char* GraphicsSystem::GLSL_INCLUDE_EXTENSION = "inc";
 const char* GraphicsSystem::DEFAULT_SHADER_NAME = "default";
 const char* GraphicsSystem::DEFAULT_SHADER_PATH = "glsl/";
+const char* GraphicsSystem::COMPOSITOR_SHADER_NAME = "compositor";
+
+// Vertexes 0, 1 and 2 become ( 0, 0 ), ( 2, 0 ) and ( 0, 2 ) in screenUV, which
+// is a triangle twice the size of the screen in each direction; the part off
+// the screen is clipped away.
+const char* GraphicsSystem::COMPOSITOR_VERTEX_SHADER_SOURCE =
+		"#version 330 core\n"
+		"uniform vec2 cgsResolutionScale = vec2( 1.0 );\n"
+		"out vec2 screenUV;\n"
+		"void main( )\n"
+		"{\n"
+		"	vec2 corner = vec2( ( gl_VertexID << 1 ) & 2, gl_VertexID & 2 );\n"
+		"	screenUV = corner * cgsResolutionScale;\n"
+		"	gl_Position = vec4( corner * 2.0 - 1.0, -1.0, 1.0 );\n"
+		"}\n";
+
+// Paired with the compositor vertex shader to draw reduced resolution stages
+// over the screen.
+const char* GraphicsSystem::UPSAMPLE_FRAGMENT_SHADER_SOURCE =
+		"#version 330 core\n"
+		"uniform sampler2D source;\n"
+		"in vec2 screenUV;\n"
+		"out vec4 color;\n"
+		"void main( )\n"
+		"{\n"
+		"	color = texture( source, screenUV );\n"
+		"}\n";
 
 AssocArray< TextureFormat, GLenum > _init_TEXTURE_FORMAT_GL_FORMAT( )
 {
@@ -130,6 +158,49 @@ GraphicsSystem::GraphicsSystem( const bool& _disableDebug )
 	framebufferHandle = 0;
 	framebufferInternalTextureHandle = 0;
 	backbufferTextureHandle = 0;
+	instanceBufferHandle = 0;
+	emptyVAOHandle = 0;
+	memset( instanceBufferHandles, 0, sizeof( instanceBufferHandles ) );
+	memset( instanceBufferCapacities, 0, sizeof( instanceBufferCapacities ) );
+	backbufferStrategy = BackbufferStrategy::COPY;
+	useNVTextureBarrier = false;
+	internalFormat = GL_NONE;
+	depthRenderbufferHandle = 0;
+	depthFormat = GL_NONE;
+	
+	multiDrawIndirect = false;
+	indirectBufferHandle = 0;
+	
+	presentMode = PresentMode::IMMEDIATE;
+	frameLimit = 0.0f;
+	frameInterval = std::chrono::steady_clock::duration::zero( );
+	frameStarted = false;
+	frameStartTime = 0;
+	memset( latencyQueries, 0, sizeof( latencyQueries ) );
+	memset( latencyFrameStarts, 0, sizeof( latencyFrameStarts ) );
+	memset( latencyQueriesPending, 0, sizeof( latencyQueriesPending ) );
+	frameLatency = 0.0;
+	
+	damageTracking = false;
+	damaged = true;
+	frameSkipped = false;
+	
+	resolutionScale = 1.0f;
+	resolutionBudget = 0.0f;
+	minimumResolutionScale = 0.5f;
+	renderX = 0;
+	renderY = 0;
+	memset( gpuTimeQueries, 0, sizeof( gpuTimeQueries ) );
+	memset( gpuTimeQueriesPending, 0, sizeof( gpuTimeQueriesPending ) );
+	gpuFrameTime = 0.0;
+	
+	nextRenderTargetHandle = CGSRenderStage::SCREEN_TARGET + 1;
+	upsampleProgramHandle = 0;
+	upsampleResolutionScaleLocation = -1;
+	sharedUniformChanges = 0;
+	
+	glMajorVersion = 0;
+	glMinorVersion = 0;
 }
 
 GraphicsSystem::~GraphicsSystem( )
@@ -151,16 +222,48 @@ GraphicsSystem::~GraphicsSystem( )
 		delete (*i);
 	}
 	
+	for( auto i = multiDrawPools.begin( ); i != multiDrawPools.end( ); ++i )
+	{
+		delete i->second;
+	}
+	
+	for( auto i = renderTargetPool.begin( ); i != renderTargetPool.end( ); ++i )
+	{
+		glDeleteFramebuffers( 1, &i->framebuffer );
+		glDeleteTextures( 1, &i->texture );
+	}
+	
+	for( auto i = stageCaches.begin( ); i != stageCaches.end( ); ++i )
+	{
+		glDeleteFramebuffers( 1, &i->second.framebuffer );
+		glDeleteTextures( 1, &i->second.texture );
+	}
+	
 	glDeleteFramebuffers( 1, &framebufferHandle );
 	glDeleteTextures( 1, &framebufferInternalTextureHandle );
 	glDeleteTextures( 1, &backbufferTextureHandle );
+	glDeleteRenderbuffers( 1, &depthRenderbufferHandle );
+	glDeleteBuffers( CGSFrameSync::MAX_FRAMES_IN_FLIGHT, instanceBufferHandles );
+	glDeleteBuffers( 1, &indirectBufferHandle );
+	glDeleteVertexArrays( 1, &emptyVAOHandle );
+	glDeleteProgram( upsampleProgramHandle );
+	glDeleteQueries( CGSFrameSync::MAX_FRAMES_IN_FLIGHT, latencyQueries );
+	glDeleteQueries( CGSFrameSync::MAX_FRAMES_IN_FLIGHT, gpuTimeQueries );
+	frameSync._release( );
+	stateCache.invalidate( );
 	
 	SDL_GL_DeleteContext( glContext );
 	SDL_DestroyWindow( sdlWindow );
 	SDL_Quit( );
 }
 
-bool GraphicsSystem::init( const uint16_t& _x, const uint16_t& _y, const String& _windowName, const String& _shaderPath )
+bool GraphicsSystem::init(
+		const uint16_t& _x,
+		const uint16_t& _y,
+		const String& _windowName,
+		const String& _shaderPath,
+		const BackbufferStrategy& _backbufferStrategy,
+		const GLenum& _internalFormat )
 {
 	assert( !inititalized );
 	
@@ -168,6 +271,8 @@ bool GraphicsSystem::init( const uint16_t& _x, const uint16_t& _y, const String&
 	
 	screenX = _x;
 	screenY = _y;
+	renderX = _x;
+	renderY = _y;
 
 	if( SDL_Init( SDL_INIT_VIDEO ) < 0 )
 	{
@@ -200,7 +305,7 @@ bool GraphicsSystem::init( const uint16_t& _x, const uint16_t& _y, const String&
 	}
 
 	glContext = SDL_GL_CreateContext( sdlWindow );
-	SDL_GL_SetSwapInterval( 0 ); // 0 is no vsync, 1 is vsync, 2 is vsync-like
+	SDL_GL_SetSwapInterval( (int)presentMode );
 
 	U::log( SDL_GetError( ) );
 	SDL_ClearError( );
@@ -237,6 +342,27 @@ bool GraphicsSystem::init( const uint16_t& _x, const uint16_t& _y, const String&
 	
 	getOpenGLErrors( );
 	
+	glGetIntegerv( GL_MAJOR_VERSION, &glMajorVersion );
+	glGetIntegerv( GL_MINOR_VERSION, &glMinorVersion );
+	
+	backbufferStrategy = _backbufferStrategy;
+	if( backbufferStrategy == BackbufferStrategy::TEXTURE_BARRIER )
+	{
+		if( isOpenGLVersionSupported( 4, 5 ) || isExtensionSupported( "GL_ARB_texture_barrier" ) )
+		{
+			useNVTextureBarrier = false;
+		}
+		else if( isExtensionSupported( "GL_NV_texture_barrier" ) )
+		{
+			useNVTextureBarrier = true;
+		}
+		else
+		{
+			U::log( "Warning: Texture barriers are not supported; the backbuffer will be copied instead." );
+			backbufferStrategy = BackbufferStrategy::COPY;
+		}
+	}
+	
 	// Check support of required features - move elsewhere later
 	GLboolean value;
 	glGetBooleanv( GL_SHADER_COMPILER, &value );
@@ -254,36 +380,204 @@ bool GraphicsSystem::init( const uint16_t& _x, const uint16_t& _y, const String&
 	// Create and configure the buffer objects. Some of this will need moved and
 	// modified when resizable windows are added [soon!].
 	glGenFramebuffers( 1, &framebufferHandle );
-	glGenTextures( 1, &framebufferInternalTextureHandle );
-	glGenTextures( 1, &backbufferTextureHandle );
+	glGenBuffers( CGSFrameSync::MAX_FRAMES_IN_FLIGHT, instanceBufferHandles );
+	instanceBufferHandle = instanceBufferHandles[ 0 ];
+	glGenBuffers( 1, &indirectBufferHandle );
+	glGenVertexArrays( 1, &emptyVAOHandle );
+	glGenQueries( CGSFrameSync::MAX_FRAMES_IN_FLIGHT, latencyQueries );
+	glGenQueries( CGSFrameSync::MAX_FRAMES_IN_FLIGHT, gpuTimeQueries );
 	
-	glBindTexture( GL_TEXTURE_2D, backbufferTextureHandle );
-	glTexStorage2D( GL_TEXTURE_2D, 1, GL_RGBA32F, screenX, screenY );
+	if( !_createFramebufferTextures( _internalFormat ) )
+	{
+		U::log( "Error: Failed to create the render target." );
+		return false;
+	}
+	
+	// Create the default vertex and fragment shaders
+	if( !getShader( ShaderType::VERTEX, DEFAULT_SHADER_NAME ) )
+	{
+		U::log( "Error: Failed to load default vertex shader." );
+		return false;
+	}
+	if( !getShader( ShaderType::FRAGMENT, DEFAULT_SHADER_NAME ) )
+	{
+		U::log( "Error: Failed to load default fragment shader." );
+		return false;
+	}
+	
+	return true;
+}
+
+bool GraphicsSystem::setInternalFormat( const GLenum& _internalFormat )
+{
+	assert( inititalized );
 	
-	glBindTexture( GL_TEXTURE_2D, framebufferInternalTextureHandle );
-	glTexStorage2D( GL_TEXTURE_2D, 1, GL_RGBA32F, screenX, screenY );
+	if( _internalFormat == internalFormat )
+	{
+		return true;
+	}
 	
-	glBindFramebuffer( GL_DRAW_FRAMEBUFFER, framebufferHandle );
+	return _createFramebufferTextures( _internalFormat );
+}
+
+bool GraphicsSystem::_createFramebufferTextures( const GLenum& _internalFormat )
+{
+	// The target is blitted to the window, which rules out integer formats, and
+	// must be color-renderable.
+	switch( _internalFormat )
+	{
+	case GL_RGBA8:
+	case GL_SRGB8_ALPHA8:
+	case GL_RGB10_A2:
+	case GL_RGBA16:
+	case GL_R11F_G11F_B10F:
+	case GL_RGBA16F:
+	case GL_RGBA32F:
+		break;
+	default:
+		U::log( "Error: Unsupported internal format for the render target: ", _internalFormat );
+		return false;
+	}
+	
+	GLuint newTargetTexture;
+	glGenTextures( 1, &newTargetTexture );
+	stateCache.bindTextureToActiveUnit( GL_TEXTURE_2D, newTargetTexture );
+	glTexStorage2D( GL_TEXTURE_2D, 1, _internalFormat, screenX, screenY );
+	
+	stateCache.bindFramebuffer( GL_DRAW_FRAMEBUFFER, framebufferHandle );
 	glFramebufferTexture2D(
 			GL_DRAW_FRAMEBUFFER,
 			GL_COLOR_ATTACHMENT0,
 			GL_TEXTURE_2D,
-			framebufferInternalTextureHandle,
+			newTargetTexture,
 			0 );
-	glBindFramebuffer( GL_DRAW_FRAMEBUFFER, 0 );
 	
-	// Create the default vertex and fragment shaders
-	if( !getShader( ShaderType::VERTEX, DEFAULT_SHADER_NAME ) )
+	if( glCheckFramebufferStatus( GL_DRAW_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
 	{
-		U::log( "Error: Failed to load default vertex shader." );
+		U::log( "Error: The render target is not renderable with internal format ", _internalFormat );
+		
+		// Put back the previous texture, if there was one.
+		glFramebufferTexture2D(
+				GL_DRAW_FRAMEBUFFER,
+				GL_COLOR_ATTACHMENT0,
+				GL_TEXTURE_2D,
+				framebufferInternalTextureHandle,
+				0 );
+		stateCache._notifyTextureDeleted( newTargetTexture );
+		glDeleteTextures( 1, &newTargetTexture );
+		stateCache.bindFramebuffer( GL_DRAW_FRAMEBUFFER, 0 );
 		return false;
 	}
-	if( !getShader( ShaderType::FRAGMENT, DEFAULT_SHADER_NAME ) )
+	
+	stateCache.bindFramebuffer( GL_DRAW_FRAMEBUFFER, 0 );
+	
+	// Textures have immutable storage, so the old ones are replaced outright.
+	stateCache._notifyTextureDeleted( framebufferInternalTextureHandle );
+	glDeleteTextures( 1, &framebufferInternalTextureHandle );
+	framebufferInternalTextureHandle = newTargetTexture;
+	
+	// With texture barriers, the render target is read directly, so there is
+	// no separate backbuffer texture. Copies need both in the same format.
+	if( backbufferStrategy == BackbufferStrategy::COPY )
 	{
-		U::log( "Error: Failed to load default fragment shader." );
+		stateCache._notifyTextureDeleted( backbufferTextureHandle );
+		glDeleteTextures( 1, &backbufferTextureHandle );
+		glGenTextures( 1, &backbufferTextureHandle );
+		stateCache.bindTextureToActiveUnit( GL_TEXTURE_2D, backbufferTextureHandle );
+		glTexStorage2D( GL_TEXTURE_2D, 1, _internalFormat, screenX, screenY );
+	}
+	
+	internalFormat = _internalFormat;
+	addDamage( );
+	return true;
+}
+
+bool GraphicsSystem::setDepthFormat( const GLenum& _depthFormat )
+{
+	assert( inititalized );
+	
+	if( _depthFormat == depthFormat )
+	{
+		return true;
+	}
+	
+	GLenum attachment;
+	
+	switch( _depthFormat )
+	{
+	case GL_NONE:
+		attachment = GL_NONE;
+		break;
+	case GL_DEPTH_COMPONENT16:
+	case GL_DEPTH_COMPONENT24:
+	case GL_DEPTH_COMPONENT32F:
+		attachment = GL_DEPTH_ATTACHMENT;
+		break;
+	case GL_DEPTH24_STENCIL8:
+	case GL_DEPTH32F_STENCIL8:
+		attachment = GL_DEPTH_STENCIL_ATTACHMENT;
+		break;
+	default:
+		U::log( "Error: Unsupported depth format: ", _depthFormat );
 		return false;
 	}
 	
+	stateCache.bindFramebuffer( GL_DRAW_FRAMEBUFFER, framebufferHandle );
+	
+	// Detaches both depth and stencil, whichever the old format had.
+	glFramebufferRenderbuffer( GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, 0 );
+	
+	GLuint newRenderbuffer = 0;
+	
+	if( attachment != GL_NONE )
+	{
+		// Depth is never sampled, so a renderbuffer is enough.
+		glGenRenderbuffers( 1, &newRenderbuffer );
+		glBindRenderbuffer( GL_RENDERBUFFER, newRenderbuffer );
+		glRenderbufferStorage( GL_RENDERBUFFER, _depthFormat, screenX, screenY );
+		glBindRenderbuffer( GL_RENDERBUFFER, 0 );
+		glFramebufferRenderbuffer( GL_DRAW_FRAMEBUFFER, attachment, GL_RENDERBUFFER, newRenderbuffer );
+		
+		if( glCheckFramebufferStatus( GL_DRAW_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+		{
+			U::log( "Error: The render target is not renderable with depth format ", _depthFormat );
+			
+			glFramebufferRenderbuffer( GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, 0 );
+			glDeleteRenderbuffers( 1, &newRenderbuffer );
+			
+			// Put back the previous attachment, if there was one.
+			if( depthRenderbufferHandle )
+			{
+				glFramebufferRenderbuffer( GL_DRAW_FRAMEBUFFER,
+						( depthFormat == GL_DEPTH24_STENCIL8 || depthFormat == GL_DEPTH32F_STENCIL8 )
+								? GL_DEPTH_STENCIL_ATTACHMENT
+								: GL_DEPTH_ATTACHMENT,
+						GL_RENDERBUFFER,
+						depthRenderbufferHandle );
+			}
+			
+			stateCache.bindFramebuffer( GL_DRAW_FRAMEBUFFER, 0 );
+			return false;
+		}
+	}
+	
+	stateCache.bindFramebuffer( GL_DRAW_FRAMEBUFFER, 0 );
+	
+	glDeleteRenderbuffers( 1, &depthRenderbufferHandle );
+	depthRenderbufferHandle = newRenderbuffer;
+	depthFormat = _depthFormat;
+	
+	if( depthRenderbufferHandle )
+	{
+		glEnable( GL_DEPTH_TEST );
+		glDepthFunc( GL_LEQUAL );
+	}
+	else
+	{
+		glDisable( GL_DEPTH_TEST );
+	}
+	
+	addDamage( );
 	return true;
 }
 
@@ -292,6 +586,168 @@ void GraphicsSystem::setDebugMode( const bool& _mode )
 	debugMode = _mode;
 }
 
+bool GraphicsSystem::setPresentMode( const PresentMode& _mode )
+{
+	assert( inititalized );
+	
+	if( SDL_GL_SetSwapInterval( (int)_mode ) == 0 )
+	{
+		presentMode = _mode;
+		return true;
+	}
+	
+	if( _mode == PresentMode::ADAPTIVE_VSYNC )
+	{
+		U::log( "Warning: Adaptive vsync is not supported; falling back to vsync." );
+		SDL_ClearError( );
+		return setPresentMode( PresentMode::VSYNC );
+	}
+	
+	U::log( "Error: Failed to set the present mode: ", SDL_GetError( ) );
+	SDL_ClearError( );
+	
+	// Some drivers change the interval even when reporting failure.
+	SDL_GL_SetSwapInterval( (int)presentMode );
+	return false;
+}
+
+void GraphicsSystem::setFrameLimit( const float& _framesPerSecond )
+{
+	frameLimit = U::max( _framesPerSecond, 0.0f );
+	
+	if( frameLimit > 0.0f )
+	{
+		frameInterval = std::chrono::duration_cast< std::chrono::steady_clock::duration >(
+				std::chrono::duration< double >( 1.0 / frameLimit ) );
+	}
+	else
+	{
+		frameInterval = std::chrono::steady_clock::duration::zero( );
+	}
+	
+	nextFrameTime = std::chrono::steady_clock::now( );
+}
+
+void GraphicsSystem::setLateLatchCallback( const std::function< void( ) >& _callback )
+{
+	lateLatchCallback = _callback;
+}
+
+void GraphicsSystem::setDamageTracking( const bool& _tracking )
+{
+	damageTracking = _tracking;
+	
+	// Nothing was tracked while it was off.
+	damaged = true;
+	damage = CGSScreenRegion( );
+}
+
+void GraphicsSystem::addDamage( const CGSScreenRegion& _region )
+{
+	if( !damageTracking )
+	{
+		return;
+	}
+	
+	if( !damaged )
+	{
+		damaged = true;
+		damage = _region;
+	}
+	else if( damage.isKnown( ) )
+	{
+		if( _region.isKnown( ) )
+		{
+			damage.merge( _region );
+		}
+		else
+		{
+			damage = CGSScreenRegion( );
+		}
+	}
+}
+
+void GraphicsSystem::setResolutionScale( const float& _scale )
+{
+	float scale = U::min( U::max( _scale, 0.25f ), 1.0f );
+	
+	if( scale == resolutionScale )
+	{
+		return;
+	}
+	
+	resolutionScale = scale;
+	
+	CGSScreenRegion rendered = _scaleRegion( CGSScreenRegion( 0, 0, screenX, screenY ) );
+	renderX = rendered.width;
+	renderY = rendered.height;
+	
+	// What is outside the new size was never rendered at the old one.
+	addDamage( );
+}
+
+void GraphicsSystem::setDynamicResolution( const float& _budget, const float& _minimumScale )
+{
+	resolutionBudget = U::max( _budget, 0.0f );
+	minimumResolutionScale = U::min( U::max( _minimumScale, 0.25f ), 1.0f );
+	
+	if( resolutionScale < minimumResolutionScale )
+	{
+		setResolutionScale( minimumResolutionScale );
+	}
+}
+
+CGSScreenRegion GraphicsSystem::_scaleRegion( const CGSScreenRegion& _region ) const
+{
+	if( !_region.isKnown( ) || resolutionScale == 1.0f )
+	{
+		return _region;
+	}
+	
+	uint16_t left = (uint16_t)floor( _region.x * resolutionScale );
+	uint16_t bottom = (uint16_t)floor( _region.y * resolutionScale );
+	uint16_t right = (uint16_t)ceil( ( (uint32_t)_region.x + _region.width ) * resolutionScale );
+	uint16_t top = (uint16_t)ceil( ( (uint32_t)_region.y + _region.height ) * resolutionScale );
+	
+	return CGSScreenRegion(
+			left,
+			bottom,
+			U::max( (uint16_t)( right - left ), (uint16_t)1 ),
+			U::max( (uint16_t)( top - bottom ), (uint16_t)1 ) );
+}
+
+void GraphicsSystem::_updateDynamicResolution( )
+{
+	if( resolutionBudget <= 0.0f || gpuFrameTime <= 0.0 )
+	{
+		return;
+	}
+	
+	// GPU time grows with the number of pixels, which is the square of the
+	// scale. Aim a little under the budget, so ordinary variation between
+	// frames does not go over it.
+	float target = resolutionScale * (float)sqrt( 0.9 * resolutionBudget / gpuFrameTime );
+	target = U::min( U::max( target, minimumResolutionScale ), 1.0f );
+	
+	// Drop at once to recover the frame rate, but rise in small steps, so one
+	// cheap frame does not cause a jump back up. Changes below one step, either
+	// way, are noise, and not worth redrawing a damage tracked screen for. The
+	// limits are the exception, as a scale within a step of one could never
+	// reach it.
+	const float step = 1.0f / 64.0f;
+	float threshold = target == 1.0f || target == minimumResolutionScale ? 0.0f : step;
+	
+	if( target < resolutionScale - threshold )
+	{
+		setResolutionScale( target );
+	}
+	else if( target > resolutionScale + threshold )
+	{
+		setResolutionScale( U::min( target,
+				resolutionScale + U::max( ( target - resolutionScale ) * 0.1f, step ) ) );
+	}
+}
+
 void GraphicsSystem::addShaderPath( const String& _path )
 {
 	shaderSearchPaths.insert( _path );
@@ -402,6 +858,75 @@ CGSMesh* GraphicsSystem::createMesh( const GLenum& _renderOperation )
 void GraphicsSystem::_notifyMeshDeleted( CGSMesh* const& mesh )
 {
 	meshes.erase( mesh->getID( ) );
+	meshUpdateQueue.erase( mesh );
+	compositorMeshes.erase( mesh );
+	
+	for( auto i = renderStages.begin( ); i != renderStages.end( ); ++i )
+	{
+		i->second._removeMesh( mesh );
+	}
+	
+	for( auto i = multiDrawPools.begin( ); i != multiDrawPools.end( ); ++i )
+	{
+		i->second->_removeMesh( mesh );
+	}
+	
+	occlusionTestedMeshes.erase( mesh );
+	
+	// Clearing a proxy changes the set, so find the users first.
+	Array< CGSMesh* > proxyUsers;
+	
+	for( auto i = occlusionTestedMeshes.begin( ); i != occlusionTestedMeshes.end( ); ++i )
+	{
+		if( (*i)->getOcclusionProxy( ) == mesh )
+		{
+			proxyUsers.push_back( *i );
+		}
+	}
+	
+	for( auto i = proxyUsers.begin( ); i != proxyUsers.end( ); ++i )
+	{
+		(*i)->setOcclusionProxy( NULL );
+	}
+}
+
+void GraphicsSystem::_notifyOcclusionProxyChanged( CGSMesh* const& _mesh )
+{
+	if( _mesh->getOcclusionProxy( ) )
+	{
+		occlusionTestedMeshes.insert( _mesh );
+	}
+	else
+	{
+		occlusionTestedMeshes.erase( _mesh );
+	}
+}
+
+void GraphicsSystem::_retainProgram( const GLuint& _program )
+{
+	++sharedProgramUsers[ _program ];
+}
+
+bool GraphicsSystem::_releaseProgram( const GLuint& _program )
+{
+	auto i = sharedProgramUsers.find( _program );
+	
+	if( i == sharedProgramUsers.end( ) )
+	{
+		return true;
+	}
+	
+	if( --i->second == 0 )
+	{
+		sharedProgramUsers.erase( i );
+	}
+	
+	return false;
+}
+
+bool GraphicsSystem::_isProgramShared( const GLuint& _program ) const
+{
+	return sharedProgramUsers.count( _program ) != 0;
 }
 
 CGSTexture* GraphicsSystem::createTexture(
@@ -459,6 +984,7 @@ CGSTexture* GraphicsSystem::createTexture(
 	}
 	
 	textures.insert( tex );
+	textureUpdateQueue.insert( tex );
 	return tex;
 }
 
@@ -607,6 +1133,7 @@ CGSTexture* GraphicsSystem::loadTextureFromFile(
 	// Clean up and store texture.
 	FreeImage_Unload( imageFile );
 	textures.insert( tex );
+	textureUpdateQueue.insert( tex );
 	textureFilesByPath.insert( U::p( _path, tex ) );
 	
 	return tex;
@@ -615,6 +1142,7 @@ CGSTexture* GraphicsSystem::loadTextureFromFile(
 void GraphicsSystem::_textureRequestDeletion( CGSTexture* const& texture )
 {
 	textures.erase( texture );
+	textureUpdateQueue.erase( texture );
 	delete texture;
 }
 
@@ -685,4 +1213,26 @@ void GraphicsSystem::getOpenGLErrors( )
 	{
 		U::log( "OpenGL error: ", String( (char*)gluErrorString( err ) ), " - ", __FILE__, ":", __LINE__ );
 	}
-}
\ No newline at end of file
+}
+
+bool GraphicsSystem::isOpenGLVersionSupported( const GLint& _major, const GLint& _minor ) const
+{
+	return glMajorVersion > _major
+			|| ( glMajorVersion == _major && glMinorVersion >= _minor );
+}
+
+bool GraphicsSystem::isExtensionSupported( const String& _name ) const
+{
+	GLint count = 0;
+	glGetIntegerv( GL_NUM_EXTENSIONS, &count );
+	
+	for( GLint i = 0; i < count; ++i )
+	{
+		if( _name == (const char*)glGetStringi( GL_EXTENSIONS, i ) )
+		{
+			return true;
+		}
+	}
+	
+	return false;
+}
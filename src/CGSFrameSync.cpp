@@ -0,0 +1,218 @@
+/*	Copyright (c) 2015-2016 William Kappler
+
+	Permission to use, copy, modify, and/or distribute this software for any
+	purpose with or without fee is hereby granted, provided that the above
+	copyright notice and this permission notice appear in all copies.
+
+	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+	REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+	AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+	INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+	LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+	OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+	PERFORMANCE OF THIS SOFTWARE. */
+
+#include "CGSFrameSync.h"
+#include "CGS.h"
+
+// Values are given in the header so they can size arrays; these are the
+// definitions required if they are ever bound to a reference.
+const uint8_t CGSFrameSync::MAX_FRAMES_IN_FLIGHT;
+const uint8_t CGSFrameSync::DEFAULT_FRAMES_IN_FLIGHT;
+
+CGSFrameSync::CGSFrameSync( )
+{
+	for( uint8_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i )
+	{
+		frames[ i ].fence = NULL;
+		frames[ i ].number = 0;
+	}
+
+	framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+	slot = 0;
+	frameNumber = 0;
+	completedFrames = 0;
+	stallCount = 0;
+}
+
+void CGSFrameSync::setFramesInFlight( const uint8_t& _frames )
+{
+	uint8_t count = U::min( U::max( _frames, (uint8_t)1 ), MAX_FRAMES_IN_FLIGHT );
+
+	if( count == framesInFlight )
+	{
+		return;
+	}
+
+	if( frameNumber )
+	{
+		waitForFrame( frameNumber - 1 );
+	}
+
+	// Anything queued during the frame being recorded moves with it to the
+	// first slot; every other slot is empty now.
+	if( slot )
+	{
+		frames[ 0 ].buffers.swap( frames[ slot ].buffers );
+		frames[ 0 ].textures.swap( frames[ slot ].textures );
+	}
+
+	framesInFlight = count;
+	slot = 0;
+}
+
+bool CGSFrameSync::isFrameComplete( const uint64_t& _frame )
+{
+	if( _frame < completedFrames )
+	{
+		return true;
+	}
+
+	if( _frame >= frameNumber )
+	{
+		return false;
+	}
+
+	// Frames complete in order, so finding the fence of _frame signaled also
+	// completes every frame before it.
+	for( uint8_t i = 0; i < framesInFlight; ++i )
+	{
+		Frame& frame = frames[ i ];
+
+		if( frame.fence && frame.number == _frame )
+		{
+			GLenum status = glClientWaitSync( frame.fence, 0, 0 );
+
+			if( status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED )
+			{
+				_retire( frame );
+				return true;
+			}
+
+			return false;
+		}
+	}
+
+	// The fence was already retired by waiting for a later frame.
+	return true;
+}
+
+void CGSFrameSync::waitForFrame( const uint64_t& _frame )
+{
+	if( _frame >= frameNumber )
+	{
+		return;
+	}
+
+	for( uint8_t i = 0; i < framesInFlight; ++i )
+	{
+		Frame& frame = frames[ i ];
+
+		if( frame.fence && frame.number <= _frame )
+		{
+			_waitForFence( frame.fence );
+			_retire( frame );
+		}
+	}
+}
+
+void CGSFrameSync::deleteBufferWhenComplete( const GLuint& _buffer )
+{
+	frames[ slot ].buffers.push_back( _buffer );
+}
+
+void CGSFrameSync::deleteTextureWhenComplete( const GLuint& _texture )
+{
+	frames[ slot ].textures.push_back( _texture );
+}
+
+void CGSFrameSync::_beginFrame( )
+{
+	Frame& frame = frames[ slot ];
+
+	if( frame.fence && !isFrameComplete( frame.number ) )
+	{
+		++stallCount;
+		_waitForFence( frame.fence );
+	}
+
+	_retire( frame );
+}
+
+void CGSFrameSync::_endFrame( )
+{
+	Frame& frame = frames[ slot ];
+	frame.fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+	frame.number = frameNumber;
+
+	++frameNumber;
+	slot = ( slot + 1 ) % framesInFlight;
+}
+
+void CGSFrameSync::_release( )
+{
+	for( uint8_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i )
+	{
+		if( frames[ i ].fence )
+		{
+			_waitForFence( frames[ i ].fence );
+		}
+
+		_retire( frames[ i ] );
+	}
+}
+
+void CGSFrameSync::_retire( Frame& _frame )
+{
+	if( _frame.fence )
+	{
+		glDeleteSync( _frame.fence );
+		_frame.fence = NULL;
+		completedFrames = U::max( completedFrames, _frame.number + 1 );
+	}
+
+	if( !_frame.buffers.empty( ) )
+	{
+		glDeleteBuffers( _frame.buffers.size( ), _frame.buffers.data( ) );
+		_frame.buffers.clear( );
+	}
+
+	if( !_frame.textures.empty( ) )
+	{
+		GraphicsSystem* graphicsSystem = GraphicsSystem::getGlobalInstance( );
+
+		for( auto i = _frame.textures.begin( ); graphicsSystem && i != _frame.textures.end( ); ++i )
+		{
+			graphicsSystem->_getStateCache( )._notifyTextureDeleted( *i );
+		}
+
+		glDeleteTextures( _frame.textures.size( ), _frame.textures.data( ) );
+		_frame.textures.clear( );
+	}
+}
+
+void CGSFrameSync::_waitForFence( const GLsync& _fence )
+{
+	// Flush on the first wait, in case the fence was never submitted. Each wait
+	// is bounded so a lost context cannot hang the program forever silently.
+	GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+
+	while( true )
+	{
+		GLenum status = glClientWaitSync( _fence, flags, 1000000000 ); // 1 second
+
+		if( status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED )
+		{
+			return;
+		}
+
+		if( status == GL_WAIT_FAILED )
+		{
+			U::log( "Error: Waiting for a frame to complete failed." );
+			return;
+		}
+
+		U::log( "Warning: Waited over a second for a frame to complete." );
+		flags = 0;
+	}
+}
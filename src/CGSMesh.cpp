@@ -18,11 +18,13 @@
 #include "CGSTexture.h"
 #include "CGSMeshToTextureAdapter.h"
 
-const GLuint CGSMesh::VERTEX_BINDING_POINT_POSITION = 0;
-const GLuint CGSMesh::VERTEX_BINDING_POINT_UVW = 1;
-const GLuint CGSMesh::VERTEX_BINDING_POINT_COLOR = 2;
-const GLuint CGSMesh::VERTEX_BINDING_POINT_NORMAL = 3;
-const GLuint CGSMesh::VERTEX_BINDING_POINT_FIRST_USER = 4;
+// Values are given in the header so they can be template arguments; these are
+// the definitions required if they are ever bound to a reference.
+const GLuint CGSMesh::VERTEX_BINDING_POINT_POSITION;
+const GLuint CGSMesh::VERTEX_BINDING_POINT_UVW;
+const GLuint CGSMesh::VERTEX_BINDING_POINT_COLOR;
+const GLuint CGSMesh::VERTEX_BINDING_POINT_NORMAL;
+const GLuint CGSMesh::VERTEX_BINDING_POINT_FIRST_USER;
 
 uint32_t CGSMesh::nextMeshObjectID = 1;
 
@@ -38,10 +40,14 @@ CGSMesh::CGSMesh( const GLenum& _renderOperation )
 	renderOperation = _renderOperation;
 	
 	visible = true;
+	attributeless = false;
 	steamIsValid = false;
 	steamUpdated = true;
+	streamNeedsFullUpload = true;
 	streamLength = -1;
 	stream = NULL;
+	streamCapacity = 0;
+	bufferCapacity = 0;
 	
 	calculatedStreamStride = -1;
 	
@@ -49,6 +55,14 @@ CGSMesh::CGSMesh( const GLenum& _renderOperation )
 	
 	useIndexes = false;
 	
+	vertexLayoutTag = NULL;
+	instanceDataSize = 0;
+	uploadCount = 0;
+	uploadedVertexCount = 0;
+	uploadedIndexCount = 0;
+	
+	textureSetKey = 0;
+	
 	// Program
 	programHandle = glCreateProgram( );
 	vertexShader
@@ -57,19 +71,52 @@ CGSMesh::CGSMesh( const GLenum& _renderOperation )
 		= GraphicsSystem::getGlobalInstance( )->getShader( ShaderType::FRAGMENT, GraphicsSystem::DEFAULT_SHADER_NAME );
 	geometryShader = NULL;
 	linked = false;
+	linkCount = 0;
+	
+	queuedForUpdate = false;
+	changeCount = 0;
+	
+	occlusionProxy = NULL;
+	
+	for( uint8_t i = 0; i < 2; ++i )
+	{
+		occlusionQueries[ i ] = 0;
+		occlusionQueryFrames[ i ] = UINT64_MAX;
+	}
+	
+	occlusionConditionalFrame = UINT64_MAX;
+	
+	_queueUpdate( );
 }
 
 CGSMesh::~CGSMesh( )
 {
-	GraphicsSystem::getGlobalInstance( )->_notifyMeshDeleted( this );
-	
-	glDeleteProgram( programHandle );
+	GraphicsSystem* graphicsSystem = GraphicsSystem::getGlobalInstance( );
 	
-	if( stream )
+	if( graphicsSystem )
 	{
-		delete[] stream;
+		graphicsSystem->_notifyMeshDeleted( this );
+		markDamaged( );
+		
+		if( !attributeless )
+		{
+			graphicsSystem->_getStateCache( )._notifyVertexArrayDeleted( vaoHandle );
+		}
+		
+		// Only delete the program if no other mesh shares it.
+		if( graphicsSystem->_releaseProgram( programHandle ) )
+		{
+			graphicsSystem->_getStateCache( )._notifyProgramDeleted( programHandle );
+			glDeleteProgram( programHandle );
+		}
+	}
+	else
+	{
+		glDeleteProgram( programHandle );
 	}
 	
+	_releaseStream( );
+	
 	// TODO: Is this enough to clean up OpenGL?
 	
 	if( useIndexes )
@@ -77,16 +124,28 @@ CGSMesh::~CGSMesh( )
 		deleteIndexBuffer( );
 	}
 	
-	// Delete the vertex array created in the constructor
-	glDeleteVertexArrays( 1, &vaoHandle );
+	// Delete the vertex array created in the constructor, unless it was
+	// replaced with a shared one.
+	if( !attributeless )
+	{
+		glDeleteVertexArrays( 1, &vaoHandle );
+	}
+	
 	glDeleteBuffers( 1, &vertexDataBufferHandle );
 	// If this tries to delete zero, it's ok, OpenGL ignores it
 	glDeleteBuffers( 1, &indexBufferHandle );
+	glDeleteQueries( 2, occlusionQueries );
 }
 
 void CGSMesh::setRenderOperation( const GLenum& mode )
 {
+	if( mode == renderOperation )
+	{
+		return;
+	}
+	
 	renderOperation = mode;
+	markDamaged( );
 }
 
 void CGSMesh::createVertexAttribute(
@@ -96,6 +155,12 @@ void CGSMesh::createVertexAttribute(
 			const bool& integerType,
 			const GLboolean& normalize )
 {
+	if( attributeless )
+	{
+		U::log( "Error: Vertex attribute created on a mesh with no vertex data in MeshObject with ID ", getID( ) );
+		return;
+	}
+	
 	AssocArray< GLuint, VertexAttributeData >::iterator i = attributeDefinitions.find( attributeIndex );
 	
 	// If a definition does not exist, create one
@@ -117,6 +182,7 @@ void CGSMesh::createVertexAttribute(
 	i->second.length = numberOfElements * GraphicsSystem::oglSizeOf( type );
 	
 	steamIsValid = false;
+	vertexLayoutTag = NULL;
 }
 
 bool CGSMesh::deleteVertexAttribute( const GLuint& attributeIndex )
@@ -127,17 +193,233 @@ bool CGSMesh::deleteVertexAttribute( const GLuint& attributeIndex )
 	{
 		attributeDefinitions.erase( i );
 		steamIsValid = false;
+		vertexLayoutTag = NULL;
 		return true;
 	}
 	
 	return false;
 }
 
+void CGSMesh::_createVertexLayout(
+		const CGSVertexAttributeInfo* const& _attributes,
+		const size_t& _count,
+		const void* const& _layoutTag )
+{
+	if( attributeless )
+	{
+		U::log( "Error: Vertex layout created on a mesh with no vertex data in MeshObject with ID ", getID( ) );
+		return;
+	}
+	
+	attributeDefinitions.clear( );
+	
+	for( size_t i = 0; i < _count; ++i )
+	{
+		createVertexAttribute(
+				_attributes[ i ].index,
+				_attributes[ i ].type,
+				_attributes[ i ].numberOfElements,
+				_attributes[ i ].integerType,
+				_attributes[ i ].normalize );
+	}
+	
+	steamIsValid = false;
+	vertexLayoutTag = _layoutTag;
+}
+
+void CGSMesh::_writeVertices(
+		const void* const& _vertexes,
+		const size_t& _count,
+		const size_t& _first,
+		const void* const& _layoutTag )
+{
+	if( !_layoutTag || _layoutTag != vertexLayoutTag )
+	{
+		U::log( "Error: writeVertices() called with a vertex layout the mesh was not created with, in MeshObject with ID ", getID( ) );
+		return;
+	}
+	
+	if( !steamIsValid || !stream || _first + _count > streamLength )
+	{
+		U::log( "Error: writeVertices() called past the end of the stream, or with no stream, in MeshObject with ID ", getID( ) );
+		return;
+	}
+	
+	memcpy( stream + _first * calculatedStreamStride, _vertexes, _count * calculatedStreamStride );
+	_markStreamDirty( _first * calculatedStreamStride, ( _first + _count ) * calculatedStreamStride );
+}
+
 void CGSMesh::generateDataStream( const uint16_t& length )
 {
+	if( attributeless )
+	{
+		U::log( "Error: generateDataStream() called on a mesh with no vertex data in MeshObject with ID ", getID( ) );
+		return;
+	}
+	
 	streamLength = length;
+	_layoutStream( );
+	
+	// Delete the current stream data. No need to inform OGL, it doesn't
+	// link itself to the pointer. We just override the data later.
+	_releaseStream( );
+	
+	if( calculatedStreamStride )
+	{
+		stream = new uint8_t[ calculatedStreamStride * streamLength ];
+		streamCapacity = streamLength;
+		_startStream( );
+	}
+	else
+	{
+		U::log( "Warning: generateDataStream() called on mesh with no vertex attributes (not even position), resulting in a zero-length (invalid) stream, in MeshObject with ID ", getID( ) );
+
+		// Failsafe values
+		steamIsValid = false;
+	}
+}
+
+void CGSMesh::resizeDataStream( const uint16_t& _length )
+{
+	// With no stream of the mesh's own, or attributes changed since it was
+	// made, there is nothing which could be kept.
+	if( !stream || !steamIsValid )
+	{
+		generateDataStream( _length );
+		return;
+	}
+	
+	if( _length > streamCapacity )
+	{
+		uint32_t capacity = growStreamCapacity( streamCapacity, _length );
+		uint8_t* grown = new uint8_t[ capacity * calculatedStreamStride ];
+		memcpy( grown, stream, streamLength * calculatedStreamStride );
+		
+		// An adopted stream is replaced by one the mesh allocated.
+		_releaseStream( );
+		stream = grown;
+		streamCapacity = capacity;
+	}
+	
+	streamLength = _length;
+	
+	if( streamLength > bufferCapacity )
+	{
+		streamNeedsFullUpload = true;
+		dirtyRanges.clear( );
+	}
+	else
+	{
+		// Writes past the new end are gone with the vertexes they were to.
+		dirtyRanges.clip( (size_t)streamLength * calculatedStreamStride );
+	}
+	
+	// Even with nothing to upload, the vertex count changes.
+	steamUpdated = true;
+	_queueUpdate( );
+}
+
+bool CGSMesh::adoptDataStream(
+		uint8_t* const& _data,
+		const uint16_t& _length,
+		const std::function< void( uint8_t* ) >& _deleter )
+{
+	// Adopting the current stream again would free it.
+	if( attributeless || !_data || _data == stream )
+	{
+		U::log( "Error: adoptDataStream() called with no data, its own stream, or on a mesh with no vertex data, in MeshObject with ID ", getID( ) );
+		return false;
+	}
+	
+	_layoutStream( );
+	
+	if( !calculatedStreamStride )
+	{
+		U::log( "Error: adoptDataStream() called on mesh with no vertex attributes in MeshObject with ID ", getID( ) );
+		steamIsValid = false;
+		return false;
+	}
+	
+	_releaseStream( );
+	stream = _data;
+	streamLength = _length;
+	streamCapacity = _length;
+	streamDeleter = _deleter;
+	_startStream( );
+	return true;
+}
+
+bool CGSMesh::adoptDataStream( std::unique_ptr< uint8_t[ ] >&& _data, const uint16_t& _length )
+{
+	if( !adoptDataStream( _data.get( ), _length, []( uint8_t* _stream ) { delete[] _stream; } ) )
+	{
+		return false;
+	}
+	
+	_data.release( );
+	return true;
+}
+
+bool CGSMesh::adoptDataStream( Array< uint8_t >&& _data )
+{
+	_layoutStream( );
+	
+	if( !calculatedStreamStride
+			|| _data.size( ) % calculatedStreamStride
+			|| _data.size( ) / calculatedStreamStride > UINT16_MAX )
+	{
+		U::log( "Error: adoptDataStream() called with data which is not a whole number of vertexes, or too many of them, in MeshObject with ID ", getID( ) );
+		return false;
+	}
 	
-	// Calculate the stride
+	// The array moves to the heap, where it lives until the stream is
+	// released. Moving a vector keeps its data where it is.
+	Array< uint8_t >* owner = new Array< uint8_t >( std::move( _data ) );
+	
+	if( !adoptDataStream(
+			owner->data( ),
+			owner->size( ) / calculatedStreamStride,
+			[ owner ]( uint8_t* ) { delete owner; } ) )
+	{
+		_data = std::move( *owner );
+		delete owner;
+		return false;
+	}
+	
+	return true;
+}
+
+bool CGSMesh::borrowDataStream( const uint8_t* const& _data, const uint16_t& _length )
+{
+	if( attributeless || !_data )
+	{
+		U::log( "Error: borrowDataStream() called with no data, or on a mesh with no vertex data, in MeshObject with ID ", getID( ) );
+		return false;
+	}
+	
+	_layoutStream( );
+	
+	if( !calculatedStreamStride )
+	{
+		U::log( "Error: borrowDataStream() called on mesh with no vertex attributes in MeshObject with ID ", getID( ) );
+		steamIsValid = false;
+		return false;
+	}
+	
+	// The mesh keeps no copy; the data goes straight to the buffer.
+	_releaseStream( );
+	streamLength = _length;
+	openAttributeIndex = -1;
+	steamIsValid = true;
+	_updateVertexFormatKey( );
+	
+	_uploadStream( _data );
+	markDamaged( );
+	return true;
+}
+
+void CGSMesh::_layoutStream( )
+{
 	calculatedStreamStride = 0;
 	
 	AssocArray< GLuint, VertexAttributeData >::iterator aDefI = attributeDefinitions.begin( );
@@ -153,37 +435,46 @@ void CGSMesh::generateDataStream( const uint16_t& length )
 		
 		++aDefI;
 	}
+}
+
+void CGSMesh::_startStream( )
+{
+	// Reset the open attribute to none; user shouldn't have an open attribute
+	// when calling this, but if they do, it should be closed.
+	openAttributeIndex = -1;
+
+	// Stream is now valid for attributes declared
+	steamIsValid = true;
+
+	// Stream needs uploaded to video card next frame or sooner - Hopefully after
+	// writing meaningful data. The buffer is resized, so all of it goes.
+	steamUpdated = true;
+	streamNeedsFullUpload = true;
+	dirtyRanges.clear( );
+	_queueUpdate( );
 	
-	if( stream )
+	_updateVertexFormatKey( );
+}
+
+void CGSMesh::_releaseStream( )
+{
+	if( !stream )
 	{
-		// Delete the current stream data. No need to inform OGL, it doesn't
-		// link itself to the pointer. We just override the data later.
-		delete[] stream;
+		return;
 	}
 	
-	if( calculatedStreamStride )
+	if( streamDeleter )
 	{
-		stream = new uint8_t[ calculatedStreamStride * streamLength ];
-
-		// Reset the open attribute to none; user shouldn't have an open attribute
-		// when calling this, but if they do, it should be closed.
-		openAttributeIndex = -1;
-
-		// Stream is now valid for attributes declared
-		steamIsValid = true;
-
-		// Stream needs uploaded to video card next frame or sooner - Hopefully after
-		// writing meaningful data.
-		steamUpdated = true;
+		streamDeleter( stream );
+		streamDeleter = nullptr;
 	}
 	else
 	{
-		U::log( "Warning: generateDataStream() called on mesh with no vertex attributes (not even position), resulting in a zero-length (invalid) stream, in MeshObject with ID ", getID( ) );
-
-		// Failsafe values
-		stream = NULL;
-		steamIsValid = false;
+		delete[] stream;
 	}
+	
+	stream = NULL;
+	streamCapacity = 0;
 }
 
 bool CGSMesh::openAttribute( const GLuint& attributeIndex )
@@ -205,6 +496,8 @@ bool CGSMesh::openAttribute( const GLuint& attributeIndex )
 	
 	openAttributeIndex = attributeIndex;
 	openAttributePosition = 0;
+	openAttributeFirstVertex = 0;
+	openAttributeMoved = false;
 	openAttributeType = aDefI->second.type;
 	openAttributeNumberOfElements = aDefI->second.numberOfElements;
 	openAttributeStride = calculatedStreamStride - aDefI->second.length;
@@ -212,28 +505,76 @@ bool CGSMesh::openAttribute( const GLuint& attributeIndex )
 	return true;
 }
 
+bool CGSMesh::moveToA( const uint16_t& _vertex )
+{
+	if( openAttributeIndex == ( GLuint )( -1 ) || _vertex >= streamLength )
+	{
+		U::log( "Warning: moveToA() called with no open attribute, or past the end of the stream, in MeshObject with ID ", getID( ) );
+		return false;
+	}
+	
+	_flushAttributeWrites( );
+	
+	openAttributePosition = _vertex * openAttributeNumberOfElements;
+	openAttributeFirstVertex = _vertex;
+	openAttributeMoved = true;
+	return true;
+}
+
+void CGSMesh::_flushAttributeWrites( )
+{
+	if( openAttributeIndex == ( GLuint )( -1 ) )
+	{
+		return;
+	}
+	
+	// Every vertex the writes reached, including one only partly written.
+	size_t endVertex = ( openAttributePosition + openAttributeNumberOfElements - 1 )
+			/ openAttributeNumberOfElements;
+	
+	if( endVertex > openAttributeFirstVertex )
+	{
+		_markStreamDirty(
+				openAttributeFirstVertex * calculatedStreamStride,
+				endVertex * calculatedStreamStride );
+	}
+	
+	openAttributeFirstVertex = endVertex;
+}
+
+void CGSMesh::_markStreamDirty( const size_t& _begin, const size_t& _end )
+{
+	steamUpdated = true;
+	_queueUpdate( );
+	
+	if( !streamNeedsFullUpload )
+	{
+		dirtyRanges.add( _begin, _end );
+	}
+}
+
 void* CGSMesh::_getDataLocationPointer( )
 {
 	// stream is a 1-byte type, not void*, so this is valid
-	return stream + (
-			// The position in a given vertex where the current attribute resides
-			openAttributeOffset
-			// Jumps between the vertex data blocks
-			+ ( openAttributePosition / openAttributeNumberOfElements ) * calculatedStreamStride
-			// Increments within the attribute itself, if multi-element
-			+ ( openAttributePosition % openAttributeNumberOfElements ) * GraphicsSystem::oglSizeOf( openAttributeType ) );
+	return stream + streamValueOffset(
+			openAttributePosition,
+			openAttributeOffset,
+			calculatedStreamStride,
+			openAttributeNumberOfElements,
+			GraphicsSystem::oglSizeOf( openAttributeType ) );
 }
 
 bool CGSMesh::_checkOpenAttribute( const GLenum& _functionType )
 {
-	// No (valid) vertex attribute index open
-	if( openAttributeIndex == ( GLuint )( -1 ) )
+	// No (valid) vertex attribute index open, or nothing to write to after
+	// borrowDataStream( )
+	if( openAttributeIndex == ( GLuint )( -1 ) || !stream )
 	{
 		return false;
 	}
 	
 	// Current location at/past end of stream
-	if( openAttributePosition >= streamLength * openAttributeNumberOfElements )
+	if( openAttributePosition >= (uint32_t)( streamLength * openAttributeNumberOfElements ) )
 	{
 		return false;
 	}
@@ -315,9 +656,103 @@ void CGSMesh::writeToA( const uint32_t& d )
 	_writeToABackend( &d, GL_UNSIGNED_INT );
 }
 
+// Store for the bulk writeToA( ) overload converting to half floats. The
+// others store values as they are, with storeStreamValue( ).
+inline void _storeHalf( uint8_t* const& _destination, const float& _value )
+{
+	uint16_t half = floatToHalf( _value );
+	memcpy( _destination, &half, sizeof( half ) );
+}
+
+template< typename T, void (*Store)( uint8_t* const&, const T& ) >
+void CGSMesh::_writeToABackend(
+		const T* const& _source,
+		const size_t& _count,
+		const size_t& _sourceStride,
+		const GLenum& _type )
+{
+	if( !_count )
+	{
+		return;
+	}
+	
+	if( !_checkOpenAttribute( _type )
+			|| openAttributePosition + _count > (size_t)streamLength * openAttributeNumberOfElements )
+	{
+		U::log( "Error: Invalid vertex attribute write operation called in MeshObject with ID ", getID( ) );
+		
+		return;
+	}
+	
+	writeStreamValues< T, Store >(
+			(uint8_t*)_getDataLocationPointer( ),
+			_source,
+			_count,
+			_sourceStride,
+			openAttributePosition,
+			openAttributeNumberOfElements,
+			GraphicsSystem::oglSizeOf( openAttributeType ),
+			openAttributeStride );
+	
+	openAttributePosition += _count;
+}
+
+void CGSMesh::writeToA( const float* const& _source, const size_t& _count, const size_t& _sourceStride )
+{
+	if( openAttributeType == GL_HALF_FLOAT )
+	{
+		_writeToABackend< float, _storeHalf >( _source, _count, _sourceStride, GL_HALF_FLOAT );
+		return;
+	}
+	
+	_writeToABackend< float, storeStreamValue< float > >( _source, _count, _sourceStride, GL_FLOAT );
+}
+
+void CGSMesh::writeToA( const double* const& _source, const size_t& _count, const size_t& _sourceStride )
+{
+	_writeToABackend< double, storeStreamValue< double > >( _source, _count, _sourceStride, GL_DOUBLE );
+}
+
+void CGSMesh::writeToA( const int8_t* const& _source, const size_t& _count, const size_t& _sourceStride )
+{
+	_writeToABackend< int8_t, storeStreamValue< int8_t > >( _source, _count, _sourceStride, GL_BYTE );
+}
+
+void CGSMesh::writeToA( const uint8_t* const& _source, const size_t& _count, const size_t& _sourceStride )
+{
+	_writeToABackend< uint8_t, storeStreamValue< uint8_t > >( _source, _count, _sourceStride, GL_UNSIGNED_BYTE );
+}
+
+void CGSMesh::writeToA( const int16_t* const& _source, const size_t& _count, const size_t& _sourceStride )
+{
+	_writeToABackend< int16_t, storeStreamValue< int16_t > >( _source, _count, _sourceStride, GL_SHORT );
+}
+
+void CGSMesh::writeToA( const uint16_t* const& _source, const size_t& _count, const size_t& _sourceStride )
+{
+	_writeToABackend< uint16_t, storeStreamValue< uint16_t > >( _source, _count, _sourceStride, GL_UNSIGNED_SHORT );
+}
+
+void CGSMesh::writeToA( const int32_t* const& _source, const size_t& _count, const size_t& _sourceStride )
+{
+	_writeToABackend< int32_t, storeStreamValue< int32_t > >( _source, _count, _sourceStride, GL_INT );
+}
+
+void CGSMesh::writeToA( const uint32_t* const& _source, const size_t& _count, const size_t& _sourceStride )
+{
+	_writeToABackend< uint32_t, storeStreamValue< uint32_t > >( _source, _count, _sourceStride, GL_UNSIGNED_INT );
+}
+
 void CGSMesh::closeAttribute( )
 {
-	if( openAttributePosition != streamLength * openAttributeNumberOfElements )
+	if( openAttributeIndex == ( GLuint )( -1 ) )
+	{
+		return;
+	}
+	
+	// After moveToA( ), writing only part of the stream is the point.
+	if( !openAttributeMoved
+			&& openAttributePosition != (uint32_t)( streamLength * openAttributeNumberOfElements ) )
 	{
 		U::log( "Warning: Incomplete write to vertex attribute with attribute index '",
 				openAttributeIndex, "' [", openAttributePosition, " out of ",
@@ -325,12 +760,97 @@ void CGSMesh::closeAttribute( )
 				" elements written] in MeshObject with ID ", getID( ) );
 	}
 	
-	steamUpdated = true;
+	_flushAttributeWrites( );
 	openAttributeIndex = -1;
 }
 
+bool CGSMesh::createInstanceAttribute( const GLuint& attributeIndex, const GLint& numberOfElements )
+{
+	// The VAO is shared, so instance attribute pointers cannot be set in it.
+	if( attributeless )
+	{
+		U::log( "Error: Instance attribute created on a mesh with no vertex data in MeshObject with ID ", getID( ) );
+		return false;
+	}
+	
+	if( numberOfElements < 1 || numberOfElements > 4 )
+	{
+		U::log( "Error: Instance attribute with index ", attributeIndex, " must have 1-4 elements, in MeshObject with ID ", getID( ) );
+		return false;
+	}
+	
+	if( attributeDefinitions.count( attributeIndex ) )
+	{
+		U::log( "Error: Instance attribute index ", attributeIndex, " is already used by a vertex attribute, in MeshObject with ID ", getID( ) );
+		return false;
+	}
+	
+	instanceAttributes[ attributeIndex ] = U::p( numberOfElements, (uint8_t)0 );
+	_layoutInstanceAttributes( );
+	_updateVertexFormatKey( );
+	return true;
+}
+
+bool CGSMesh::deleteInstanceAttribute( const GLuint& attributeIndex )
+{
+	if( !instanceAttributes.erase( attributeIndex ) )
+	{
+		return false;
+	}
+	
+	GraphicsSystem::getGlobalInstance( )->_getStateCache( ).bindVertexArray( vaoHandle );
+	glVertexAttribDivisor( attributeIndex, 0 );
+	glDisableVertexAttribArray( attributeIndex );
+	
+	_layoutInstanceAttributes( );
+	_updateVertexFormatKey( );
+	return true;
+}
+
+void CGSMesh::_layoutInstanceAttributes( )
+{
+	instanceDataSize = 0;
+	
+	for( auto i = instanceAttributes.begin( ); i != instanceAttributes.end( ); ++i )
+	{
+		i->second.second = instanceDataSize;
+		instanceDataSize += i->second.first;
+	}
+}
+
+void CGSMesh::_updateVertexFormatKey( )
+{
+	vertexFormatKey.clear( );
+	
+	if( !steamIsValid )
+	{
+		return;
+	}
+	
+	// Everything glVertexAttrib*Pointer( ) is given, for every attribute.
+	for( auto i = attributeDefinitions.begin( ); i != attributeDefinitions.end( ); ++i )
+	{
+		vertexFormatKey += U::c( i->first, ":", i->second.type, ":",
+				i->second.numberOfElements, ":", i->second.useInterger, ":",
+				(int)i->second.normalize, ":", i->second.streamPointerOffset, ";" );
+	}
+	
+	vertexFormatKey += U::c( calculatedStreamStride, "|" );
+	
+	for( auto i = instanceAttributes.begin( ); i != instanceAttributes.end( ); ++i )
+	{
+		vertexFormatKey += U::c( i->first, ":", i->second.first, ";" );
+	}
+}
+
 void CGSMesh::createIndexBuffer( const uint16_t& preallocate )
 {
+	if( attributeless )
+	{
+		U::log( "Error: CGSMesh::createIndexBuffer() called on a mesh with no vertex data in MeshObject with ID ", getID( ) );
+		return;
+	}
+	
 	if( useIndexes )
 	{
 		U::log( "Warning: CGSMesh::createIndexBuffer() called, but index buffer already exists in MeshObject with ID ", getID( ), " - clearing instead" );
@@ -345,18 +865,21 @@ void CGSMesh::createIndexBuffer( const uint16_t& preallocate )
 	
 	indexData.reserve( preallocate );
 	indexesUpdated = true;
+	_queueUpdate( );
 }
 
 void CGSMesh::writeToI( const uint32_t& d, const uint16_t& at )
 {
 	indexData[ at ] = d;
 	indexesUpdated = true;
+	_queueUpdate( );
 }
 
 void CGSMesh::writeToI( const uint32_t& d )
 {
 	indexData[ indexPosition++ ] = d;
 	indexesUpdated = true;
+	_queueUpdate( );
 }
 
 bool CGSMesh::moveToI( const uint16_t& newPos )
@@ -380,6 +903,7 @@ void CGSMesh::clearIndexBuffer( )
 	indexData.clear( );
 	indexPosition = 0;
 	indexesUpdated = true;
+	_queueUpdate( );
 }
 
 void CGSMesh::deleteIndexBuffer( )
@@ -394,6 +918,9 @@ void CGSMesh::deleteIndexBuffer( )
 
 void CGSMesh::_update( )
 {
+	// Anything changing from here on queues the mesh again.
+	queuedForUpdate = false;
+	
 	if( !visible )
 	{
 		return;
@@ -401,14 +928,22 @@ void CGSMesh::_update( )
 	
 	_linkProgram( );
 	
+	// Nothing to upload, and the shared VAO must not be touched.
+	if( attributeless )
+	{
+		return;
+	}
+	
 	if( !steamIsValid )
 	{
 		U::log( "Error: Cannot upload mesh data to OpenGL as vertex attributes are not valid. This is likely due to failing to call generateDataStream( ) and populate the stream with valid data." );
 		return;
 	}
 	
-	// Bind the VAO
-	glBindVertexArray( vaoHandle );
+	CGSStateCache& stateCache = GraphicsSystem::getGlobalInstance( )->_getStateCache( );
+	
+	// Bind the VAO. It is left bound afterwards; the state cache tracks it.
+	stateCache.bindVertexArray( vaoHandle );
 	
 	// Indexes
 	if( useIndexes && indexesUpdated )
@@ -424,71 +959,302 @@ void CGSMesh::_update( )
 				indexData.data( ),
 				GL_DYNAMIC_DRAW );
 		
-		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+		// The element buffer binding is part of the VAO, so it must stay bound.
 		
 		indexesUpdated = false;
+		uploadedIndexCount = indexData.size( );
+		++uploadCount;
 	}
 	
 	// Vertex attribute data - much more complex
 	if( steamUpdated )
 	{
-		glBindBuffer( GL_ARRAY_BUFFER, vertexDataBufferHandle );
-		glBufferData( GL_ARRAY_BUFFER, 0, NULL, GL_DYNAMIC_DRAW );
-		glBufferData( GL_ARRAY_BUFFER, streamLength * calculatedStreamStride, stream, GL_DYNAMIC_DRAW );
-		
-		// Define attribute locations
-		for( AssocArray< GLuint, VertexAttributeData >::iterator i = attributeDefinitions.begin( );
-			i != attributeDefinitions.end( ); ++i )
+		_uploadDirtyRanges( );
+	}
+}
+
+void CGSMesh::_uploadDirtyRanges( )
+{
+	if( streamNeedsFullUpload
+			|| streamLength > bufferCapacity
+			|| dirtyRanges.coversMostOf( (size_t)streamLength * calculatedStreamStride ) )
+	{
+		_uploadStream( stream );
+		return;
+	}
+	
+	glBindBuffer( GL_ARRAY_BUFFER, vertexDataBufferHandle );
+	
+	const Array< CGSStreamDirtyRanges::Range >& ranges = dirtyRanges.getRanges( );
+	for( auto i = ranges.begin( ); i != ranges.end( ); ++i )
+	{
+		glBufferSubData( GL_ARRAY_BUFFER, i->first, i->second - i->first, stream + i->first );
+	}
+	
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	
+	dirtyRanges.clear( );
+	steamUpdated = false;
+	uploadedVertexCount = streamLength;
+	++uploadCount;
+}
+
+void CGSMesh::_uploadStream( const uint8_t* const& _data )
+{
+	GraphicsSystem::getGlobalInstance( )->_getStateCache( ).bindVertexArray( vaoHandle );
+	
+	// The buffer gets the same room to grow as the stream, so resizing within
+	// it only uploads the vertexes written.
+	bufferCapacity = U::max( streamCapacity, (uint32_t)streamLength );
+	
+	glBindBuffer( GL_ARRAY_BUFFER, vertexDataBufferHandle );
+	glBufferData( GL_ARRAY_BUFFER, 0, NULL, GL_DYNAMIC_DRAW );
+	
+	if( bufferCapacity == streamLength )
+	{
+		glBufferData( GL_ARRAY_BUFFER, streamLength * calculatedStreamStride, _data, GL_DYNAMIC_DRAW );
+	}
+	else
+	{
+		glBufferData( GL_ARRAY_BUFFER, bufferCapacity * calculatedStreamStride, NULL, GL_DYNAMIC_DRAW );
+		glBufferSubData( GL_ARRAY_BUFFER, 0, streamLength * calculatedStreamStride, _data );
+	}
+	
+	_setVertexAttributePointers( );
+	
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	
+	steamUpdated = false;
+	streamNeedsFullUpload = false;
+	dirtyRanges.clear( );
+	uploadedVertexCount = streamLength;
+	++uploadCount;
+}
+
+void CGSMesh::_makeAttributeless( const GLuint& _sharedVAO, const uint16_t& _vertexCount )
+{
+	if( !attributeless )
+	{
+		GraphicsSystem::getGlobalInstance( )->_getStateCache( )._notifyVertexArrayDeleted( vaoHandle );
+		glDeleteVertexArrays( 1, &vaoHandle );
+		glDeleteBuffers( 1, &vertexDataBufferHandle );
+		vertexDataBufferHandle = 0;
+	}
+	
+	attributeless = true;
+	vaoHandle = _sharedVAO;
+	streamLength = _vertexCount;
+	uploadedVertexCount = _vertexCount;
+	steamIsValid = true;
+	steamUpdated = false;
+}
+
+void CGSMesh::setVisibility( const bool& _visibility )
+{
+	// Appearing and disappearing both change what is under the mesh.
+	if( visible != _visibility )
+	{
+		++changeCount;
+		GraphicsSystem::getGlobalInstance( )->addDamage( screenBounds );
+	}
+	
+	visible = _visibility;
+	
+	// Invisible meshes are skipped by _update( ), so catch up now.
+	if( visible && _needsUpdate( ) )
+	{
+		_queueUpdate( );
+	}
+}
+
+void CGSMesh::setScreenBounds( const CGSScreenRegion& _bounds )
+{
+	// Both where the mesh was and where it is now need redrawn.
+	markDamaged( );
+	screenBounds = _bounds;
+	markDamaged( );
+}
+
+void CGSMesh::markDamaged( )
+{
+	++changeCount;
+	
+	if( visible )
+	{
+		GraphicsSystem::getGlobalInstance( )->addDamage( screenBounds );
+	}
+}
+
+void CGSMesh::setOcclusionProxy( CGSMesh* const& _proxy )
+{
+	if( _proxy == occlusionProxy || _proxy == this )
+	{
+		return;
+	}
+	
+	occlusionProxy = _proxy;
+	GraphicsSystem::getGlobalInstance( )->_notifyOcclusionProxyChanged( this );
+	
+	// Results of the old proxy say nothing about the new one.
+	occlusionQueryFrames[ 0 ] = UINT64_MAX;
+	occlusionQueryFrames[ 1 ] = UINT64_MAX;
+	occlusionConditionalFrame = UINT64_MAX;
+	markDamaged( );
+}
+
+GLuint CGSMesh::_getOcclusionQuery( const uint64_t& _frame ) const
+{
+	if( occlusionQueryFrames[ _frame % 2 ] != _frame )
+	{
+		return 0;
+	}
+	
+	return occlusionQueries[ _frame % 2 ];
+}
+
+GLuint CGSMesh::_startOcclusionQuery( const uint64_t& _frame )
+{
+	if( !occlusionQueries[ 0 ] )
+	{
+		glGenQueries( 2, occlusionQueries );
+	}
+	
+	occlusionQueryFrames[ _frame % 2 ] = _frame;
+	return occlusionQueries[ _frame % 2 ];
+}
+
+void CGSMesh::_queueUpdate( )
+{
+	markDamaged( );
+	
+	if( queuedForUpdate )
+	{
+		return;
+	}
+	
+	queuedForUpdate = true;
+	GraphicsSystem::getGlobalInstance( )->_queueMeshUpdate( this );
+}
+
+void CGSMesh::_setVertexAttributePointers( )
+{
+	// Define attribute locations
+	for( AssocArray< GLuint, VertexAttributeData >::iterator i = attributeDefinitions.begin( );
+		i != attributeDefinitions.end( ); ++i )
+	{
+		if( i->second.useInterger )
 		{
-			if( i->second.useInterger )
-			{
-				// glVertexAttrib_I_Pointer i->second.
-				glVertexAttribIPointer( i->first, // Index
-					i->second.numberOfElements, // 1-4
-					i->second.type,
-					calculatedStreamStride, // Spacing between element blocks
-					(char*)(uintptr_t)i->second.streamPointerOffset );
-			}
-			else if( i->second.type == GL_DOUBLE )
-			{
-				// glVertexAttrib_L_Pointer
-				glVertexAttribLPointer( i->first,
-					i->second.numberOfElements,
-					GL_DOUBLE,
-					calculatedStreamStride,
-					(char*)(uintptr_t)i->second.streamPointerOffset );
-			}
-			else
-			{
-				// Just normal glVertexAttribPointer
-				glVertexAttribPointer( i->first,
-					i->second.numberOfElements,
-					i->second.type,
-					i->second.normalize,
-					calculatedStreamStride,
-					(char*)(uintptr_t)i->second.streamPointerOffset );
-			}
-			
-			// Enable the above-specified attribute
-			glEnableVertexAttribArray( i->first );
+			// glVertexAttrib_I_Pointer i->second.
+			glVertexAttribIPointer( i->first, // Index
+				i->second.numberOfElements, // 1-4
+				i->second.type,
+				calculatedStreamStride, // Spacing between element blocks
+				(char*)(uintptr_t)i->second.streamPointerOffset );
+		}
+		else if( i->second.type == GL_DOUBLE )
+		{
+			// glVertexAttrib_L_Pointer
+			glVertexAttribLPointer( i->first,
+				i->second.numberOfElements,
+				GL_DOUBLE,
+				calculatedStreamStride,
+				(char*)(uintptr_t)i->second.streamPointerOffset );
+		}
+		else
+		{
+			// Just normal glVertexAttribPointer
+			glVertexAttribPointer( i->first,
+				i->second.numberOfElements,
+				i->second.type,
+				i->second.normalize,
+				calculatedStreamStride,
+				(char*)(uintptr_t)i->second.streamPointerOffset );
 		}
 		
-		glBindBuffer( GL_ARRAY_BUFFER, 0 );
-		
-		steamUpdated = false;
+		// Enable the above-specified attribute
+		glEnableVertexAttribArray( i->first );
+	}
+}
+
+void CGSMesh::_setInstanceAttributePointers(
+		const GLuint& _instanceBuffer,
+		const GLintptr& _instanceBufferOffset )
+{
+	glBindBuffer( GL_ARRAY_BUFFER, _instanceBuffer );
+	
+	for( auto i = instanceAttributes.begin( ); i != instanceAttributes.end( ); ++i )
+	{
+		glVertexAttribPointer( i->first,
+			i->second.first,
+			GL_FLOAT,
+			GL_FALSE,
+			instanceDataSize * sizeof( float ),
+			(char*)(uintptr_t)( _instanceBufferOffset + i->second.second * sizeof( float ) ) );
+		glVertexAttribDivisor( i->first, 1 );
+		glEnableVertexAttribArray( i->first );
+	}
+	
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
+
+void CGSMesh::_bindTextures( )
+{
+	for( auto i = textures.begin( ); i != textures.end( ); ++i )
+	{
+		i->second.bind( );
+	}
+}
+
+bool CGSMesh::_canMultiDrawWith( CGSMesh* const& _other )
+{
+	// Each is drawn on its own, inside its own conditional render.
+	if( occlusionProxy || _other->occlusionProxy )
+	{
+		return false;
+	}
+	
+	if( _other == this )
+	{
+		return true;
+	}
+	
+	if( programHandle != _other->programHandle
+			|| renderOperation != _other->renderOperation
+			|| useIndexes != _other->useIndexes
+			|| !visible || !_other->visible
+			|| !steamIsValid || !_other->steamIsValid
+			|| vertexFormatKey.empty( )
+			|| vertexFormatKey != _other->vertexFormatKey
+			|| textures.size( ) != _other->textures.size( ) )
+	{
+		return false;
+	}
+	
+	// The texture set key may collide, so compare the actual attachments.
+	for( auto i = textures.begin( ), j = _other->textures.begin( );
+		i != textures.end( ); ++i, ++j )
+	{
+		if( i->first != j->first
+				|| i->second.getTexture( ) != j->second.getTexture( ) )
+		{
+			return false;
+		}
 	}
 	
-	glBindVertexArray( 0 );
+	return true;
 }
 
-void CGSMesh::_render( )
+void CGSMesh::_render(
+		const GLsizei& _instanceCount,
+		const GLuint& _instanceBuffer,
+		const GLintptr& _instanceBufferOffset )
 {
 	if( !visible )
 	{
 		return;
 	}
 	
-	if( steamUpdated || !linked || ( useIndexes && indexesUpdated ) )
+	if( _needsUpdate( ) )
 	{
 		_update( );
 	}
@@ -511,20 +1277,43 @@ void CGSMesh::_render( )
 	// Moved this from _update( ) - I seem to have misplaced it there when I wrote
 	// this. Textures are bound to render, not update.
 	
-	// Bind textures
-	for( auto i = textures.begin( ); i != textures.end( ); ++i )
-	{
-		i->second.bind( );
-	}
+	_bindTextures( );
 	
-	// Actually draw the mesh
-	glUseProgram( programHandle );
+	// Actually draw the mesh. Bindings are left in place for the next mesh; the
+	// state cache skips them if that mesh uses the same ones.
+	CGSStateCache& stateCache = GraphicsSystem::getGlobalInstance( )->_getStateCache( );
+	stateCache.useProgram( programHandle );
+	stateCache.bindVertexArray( vaoHandle );
 	
-	glBindVertexArray( vaoHandle );
-	glDrawArrays( renderOperation, 0, numberOfVertexes );
-	glBindVertexArray( 0 );
+	// Instance attributes point at a different part of the instance buffer for
+	// every draw, so they are set here rather than in _update( ).
+	if( instanceDataSize && _instanceBuffer )
+	{
+		_setInstanceAttributePointers( _instanceBuffer, _instanceBufferOffset );
+	}
 	
-	glUseProgram( 0 );
+	if( useIndexes )
+	{
+		if( _instanceCount == 1 )
+		{
+			glDrawElements( renderOperation, numberOfVertexes, GL_UNSIGNED_INT, 0 );
+		}
+		else
+		{
+			glDrawElementsInstanced( renderOperation, numberOfVertexes, GL_UNSIGNED_INT, 0, _instanceCount );
+		}
+	}
+	else
+	{
+		if( _instanceCount == 1 )
+		{
+			glDrawArrays( renderOperation, 0, numberOfVertexes );
+		}
+		else
+		{
+			glDrawArraysInstanced( renderOperation, 0, numberOfVertexes, _instanceCount );
+		}
+	}
 }
 
 // PROGRAM FUNCTIONS =============================================================
@@ -539,6 +1328,23 @@ const GLuint& CGSMesh::_getProgramHandle( const bool& forceLink )
 	return programHandle;
 }
 
+const GLuint& CGSMesh::_getUniformProgramHandle( )
+{
+	GraphicsSystem* graphicsSystem = GraphicsSystem::getGlobalInstance( );
+	
+	if( graphicsSystem->_isProgramShared( programHandle ) )
+	{
+		graphicsSystem->_notifySharedUniformChanged( );
+		graphicsSystem->addDamage( );
+	}
+	else
+	{
+		markDamaged( );
+	}
+	
+	return _getProgramHandle( true );
+}
+
 bool CGSMesh::loadVertexShader( const String& _fileName )
 {
 	CGSShader* temp
@@ -546,8 +1352,10 @@ bool CGSMesh::loadVertexShader( const String& _fileName )
 		
 	if( temp )
 	{
+		_unshareProgram( );
 		vertexShader = temp;
 		linked = false;
+		_queueUpdate( );
 		return true;
 	}
 	else
@@ -563,8 +1371,10 @@ bool CGSMesh::loadFragmentShader( const String& _fileName )
 		
 	if( temp )
 	{
+		_unshareProgram( );
 		fragmentShader = temp;
 		linked = false;
+		_queueUpdate( );
 		return true;
 	}
 	else
@@ -580,8 +1390,10 @@ bool CGSMesh::loadGeometryShader( const String& _fileName )
 		
 	if( temp )
 	{
+		_unshareProgram( );
 		geometryShader = temp;
 		linked = false;
+		_queueUpdate( );
 		return true;
 	}
 	else
@@ -599,8 +1411,10 @@ bool CGSMesh::attachVertexShader( CGSShader* const& _shader )
 		return false;
 	}
 	
+	_unshareProgram( );
 	vertexShader = _shader;
 	linked = false;
+	_queueUpdate( );
 	return true;
 }
 
@@ -613,8 +1427,10 @@ bool CGSMesh::attachFragmentShader( CGSShader* const& _shader )
 		return false;
 	}
 	
+	_unshareProgram( );
 	fragmentShader = _shader;
 	linked = false;
+	_queueUpdate( );
 	return true;
 }
 
@@ -627,12 +1443,73 @@ bool CGSMesh::attachGeometryShader( CGSShader* const& _shader )
 		return false;
 	}
 	
+	_unshareProgram( );
 	geometryShader = _shader;
 	linked = false;
+	_queueUpdate( );
 	return true;
 }
 
 
+bool CGSMesh::shareProgram( CGSMesh* const& _source )
+{
+	if( !_source || _source == this )
+	{
+		return false;
+	}
+	
+	if( _source->programHandle == programHandle )
+	{
+		return true;
+	}
+	
+	GraphicsSystem* graphicsSystem = GraphicsSystem::getGlobalInstance( );
+	
+	if( graphicsSystem->_releaseProgram( programHandle ) )
+	{
+		graphicsSystem->_getStateCache( )._notifyProgramDeleted( programHandle );
+		glDeleteProgram( programHandle );
+	}
+	
+	programHandle = _source->programHandle;
+	graphicsSystem->_retainProgram( programHandle );
+	
+	vertexShader = _source->vertexShader;
+	fragmentShader = _source->fragmentShader;
+	geometryShader = _source->geometryShader;
+	linked = _source->linked;
+	
+	// Textures set their range uniforms on the program they are attached
+	// through, so reattach ours to set them on the shared one.
+	for( auto i = textures.begin( ); i != textures.end( ); ++i )
+	{
+		CGSTexture* texture = i->second.getTexture( );
+		
+		if( texture )
+		{
+			i->second.breakLink( );
+			i->second.link( texture, i->first, this );
+		}
+	}
+	
+	return true;
+}
+
+void CGSMesh::_unshareProgram( )
+{
+	GraphicsSystem* graphicsSystem = GraphicsSystem::getGlobalInstance( );
+	
+	if( !graphicsSystem->_isProgramShared( programHandle ) )
+	{
+		return;
+	}
+	
+	graphicsSystem->_releaseProgram( programHandle );
+	programHandle = glCreateProgram( );
+	linked = false;
+	_queueUpdate( );
+}
+
 CGSShader* CGSMesh::getShaderAttached( const ShaderType& _type ) const
 {
 	if( _type == ShaderType::VERTEX )
@@ -663,8 +1540,10 @@ void CGSMesh::bindAttributeLocation( const GLuint& _bindingIndex, const String&
 
 void CGSMesh::bindAttributeLocation( const GLuint& _bindingIndex, const GLchar* const& _variableName )
 {
+	_unshareProgram( );
 	glBindAttribLocation( programHandle, _bindingIndex, _variableName );
 	linked = false;
+	_queueUpdate( );
 }
 
 bool CGSMesh::_linkProgram( )
@@ -699,7 +1578,7 @@ bool CGSMesh::_linkProgram( )
 	if( status == GL_TRUE )
 	{
 		linked = true;
-		glUseProgram( 0 );
+		++linkCount;
 		return true;
 	}
 	else
@@ -742,6 +1621,8 @@ void CGSMesh::attachTexture( const uint8_t& _unit, CGSTexture* const& _tex )
 	// If a link already exists at _unit, it is implicitly unlinked. So this is
 	// safe even though it looks iffy.
 	textures[ _unit ].link( _tex, _unit, this );
+	_updateTextureSetKey( );
+	markDamaged( );
 }
 
 bool CGSMesh::detachTexture( const uint8_t& _unit )
@@ -754,6 +1635,8 @@ bool CGSMesh::detachTexture( const uint8_t& _unit )
 		// LINKED. A connector merely existing does not count, it must be valid.
 		bool r = i->second.isValid( );
 		textures.erase( i );
+		_updateTextureSetKey( );
+		markDamaged( );
 		return r;
 	}
 	
@@ -771,4 +1654,24 @@ CGSTexture* CGSMesh::getAttachedTexture( const uint8_t& _unit )
 	}
 	
 	return NULL;
-}
\ No newline at end of file
+}
+
+void CGSMesh::_updateTextureSetKey( )
+{
+	// FNV-1a over the unit and texture pointer of each attachment. Adapters are
+	// ordered by unit, so the same set always produces the same key.
+	uint64_t hash = 14695981039346656037ULL;
+	
+	for( auto i = textures.begin( ); i != textures.end( ); ++i )
+	{
+		if( !i->second.isValid( ) )
+		{
+			continue;
+		}
+		
+		hash = ( hash ^ i->first ) * 1099511628211ULL;
+		hash = ( hash ^ (uintptr_t)i->second.getTexture( ) ) * 1099511628211ULL;
+	}
+	
+	textureSetKey = (uint16_t)( hash ^ ( hash >> 16 ) ^ ( hash >> 32 ) ^ ( hash >> 48 ) );
+}
@@ -0,0 +1,207 @@
+/*	Copyright (c) 2015-2016 William Kappler
+
+	Permission to use, copy, modify, and/or distribute this software for any
+	purpose with or without fee is hereby granted, provided that the above
+	copyright notice and this permission notice appear in all copies.
+
+	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+	REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+	AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+	INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+	LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+	OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+	PERFORMANCE OF THIS SOFTWARE. */
+
+#include "CGSMultiDrawPool.h"
+#include "CGSMesh.h"
+
+const GLuint CGSMultiDrawPool::MINIMUM_CAPACITY = 1024;
+
+CGSMultiDrawPool::CGSMultiDrawPool( CGSMesh* const& _formatSource )
+{
+	glGenVertexArrays( 1, &vaoHandle );
+	glGenBuffers( 1, &vertexBufferHandle );
+	glGenBuffers( 1, &indexBufferHandle );
+
+	formatSource = _formatSource;
+	formatKey = _formatSource->_getVertexFormatKey( );
+	stride = _formatSource->_getStreamStride( );
+
+	// Nothing is allocated until the first mesh is prepared.
+	vertexCapacity = 0;
+	vertexUsed = 0;
+	indexCapacity = 0;
+	indexUsed = 0;
+}
+
+CGSMultiDrawPool::~CGSMultiDrawPool( )
+{
+	GraphicsSystem* graphicsSystem = GraphicsSystem::getGlobalInstance( );
+
+	if( graphicsSystem )
+	{
+		graphicsSystem->_getStateCache( )._notifyVertexArrayDeleted( vaoHandle );
+	}
+
+	glDeleteVertexArrays( 1, &vaoHandle );
+	glDeleteBuffers( 1, &vertexBufferHandle );
+	glDeleteBuffers( 1, &indexBufferHandle );
+}
+
+void CGSMultiDrawPool::_prepareMesh( CGSMesh* const& _mesh )
+{
+	GLuint vertexes = _mesh->_getVertexCount( );
+	GLuint indexes = _mesh->_usesIndexes( ) ? _mesh->_getIndexCount( ) : 0;
+
+	auto i = slots.find( _mesh );
+
+	if( i != slots.end( ) )
+	{
+		if( i->second.uploadCount == _mesh->_getUploadCount( ) )
+		{
+			return;
+		}
+
+		if( vertexes <= i->second.vertexCapacity && indexes <= i->second.indexCapacity )
+		{
+			_copyMesh( _mesh, i->second );
+			return;
+		}
+
+		// The mesh grew out of its slot. It gets a new one below; the old space
+		// is reclaimed the next time the pool grows.
+		slots.erase( i );
+	}
+
+	if( !formatSource )
+	{
+		formatSource = _mesh;
+	}
+
+	if( vertexUsed + vertexes > vertexCapacity || indexUsed + indexes > indexCapacity )
+	{
+		_grow( vertexes, indexes );
+	}
+
+	Slot& slot = slots[ _mesh ];
+	slot.firstVertex = vertexUsed;
+	slot.vertexCapacity = vertexes;
+	slot.firstIndex = indexUsed;
+	slot.indexCapacity = indexes;
+
+	vertexUsed += vertexes;
+	indexUsed += indexes;
+
+	_copyMesh( _mesh, slot );
+}
+
+void CGSMultiDrawPool::_removeMesh( CGSMesh* const& _mesh )
+{
+	slots.erase( _mesh );
+
+	if( formatSource == _mesh )
+	{
+		formatSource = slots.empty( ) ? NULL : slots.begin( )->first;
+	}
+}
+
+void CGSMultiDrawPool::_grow( const GLuint& _extraVertexes, const GLuint& _extraIndexes )
+{
+	// Meshes whose format changed since they were added belong to another pool
+	// now, and their data would not fit this one's layout.
+	GLuint liveVertexes = _extraVertexes;
+	GLuint liveIndexes = _extraIndexes;
+
+	for( auto i = slots.begin( ); i != slots.end( ); )
+	{
+		if( i->first->_getVertexFormatKey( ) != formatKey )
+		{
+			i = slots.erase( i );
+			continue;
+		}
+
+		liveVertexes += i->first->_getVertexCount( );
+		liveIndexes += i->first->_usesIndexes( ) ? i->first->_getIndexCount( ) : 0;
+		++i;
+	}
+
+	if( formatSource && formatSource->_getVertexFormatKey( ) != formatKey )
+	{
+		formatSource = slots.empty( ) ? NULL : slots.begin( )->first;
+	}
+
+	// Doubling leaves room to add meshes for a while before growing again.
+	vertexCapacity = U::max( MINIMUM_CAPACITY, liveVertexes * 2 );
+	indexCapacity = U::max( MINIMUM_CAPACITY, liveIndexes * 2 );
+
+	glDeleteBuffers( 1, &vertexBufferHandle );
+	glDeleteBuffers( 1, &indexBufferHandle );
+	glGenBuffers( 1, &vertexBufferHandle );
+	glGenBuffers( 1, &indexBufferHandle );
+
+	glBindBuffer( GL_COPY_WRITE_BUFFER, vertexBufferHandle );
+	glBufferData( GL_COPY_WRITE_BUFFER, vertexCapacity * stride, NULL, GL_DYNAMIC_DRAW );
+	glBindBuffer( GL_COPY_WRITE_BUFFER, indexBufferHandle );
+	glBufferData( GL_COPY_WRITE_BUFFER, indexCapacity * sizeof( uint32_t ), NULL, GL_DYNAMIC_DRAW );
+	glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+
+	// Pack every mesh in again from the start.
+	vertexUsed = 0;
+	indexUsed = 0;
+
+	for( auto i = slots.begin( ); i != slots.end( ); ++i )
+	{
+		i->second.firstVertex = vertexUsed;
+		i->second.vertexCapacity = i->first->_getVertexCount( );
+		i->second.firstIndex = indexUsed;
+		i->second.indexCapacity = i->first->_usesIndexes( ) ? i->first->_getIndexCount( ) : 0;
+
+		vertexUsed += i->second.vertexCapacity;
+		indexUsed += i->second.indexCapacity;
+
+		_copyMesh( i->first, i->second );
+	}
+
+	// Point the VAO at the new buffers.
+	GraphicsSystem::getGlobalInstance( )->_getStateCache( ).bindVertexArray( vaoHandle );
+
+	if( formatSource )
+	{
+		glBindBuffer( GL_ARRAY_BUFFER, vertexBufferHandle );
+		formatSource->_setVertexAttributePointers( );
+		glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	}
+
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, indexBufferHandle );
+}
+
+void CGSMultiDrawPool::_copyMesh( CGSMesh* const& _mesh, Slot& _slot )
+{
+	GLuint vertexes = _mesh->_getVertexCount( );
+	GLuint indexes = _mesh->_usesIndexes( ) ? _mesh->_getIndexCount( ) : 0;
+
+	if( vertexes )
+	{
+		glBindBuffer( GL_COPY_READ_BUFFER, _mesh->_getVertexBufferHandle( ) );
+		glBindBuffer( GL_COPY_WRITE_BUFFER, vertexBufferHandle );
+		glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+				0,
+				_slot.firstVertex * stride,
+				vertexes * stride );
+	}
+
+	if( indexes )
+	{
+		glBindBuffer( GL_COPY_READ_BUFFER, _mesh->_getIndexBufferHandle( ) );
+		glBindBuffer( GL_COPY_WRITE_BUFFER, indexBufferHandle );
+		glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+				0,
+				_slot.firstIndex * sizeof( uint32_t ),
+				indexes * sizeof( uint32_t ) );
+	}
+
+	glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+	glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+
+	_slot.uploadCount = _mesh->_getUploadCount( );
+}
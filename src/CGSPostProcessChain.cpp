@@ -0,0 +1,119 @@
+/*	Copyright (c) 2015-2016 William Kappler
+
+	Permission to use, copy, modify, and/or distribute this software for any
+	purpose with or without fee is hereby granted, provided that the above
+	copyright notice and this permission notice appear in all copies.
+
+	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+	REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+	AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+	INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+	LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+	OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+	PERFORMANCE OF THIS SOFTWARE. */
+
+#include "CGSPostProcessChain.h"
+#include "CGSMesh.h"
+
+CGSPostProcessChain::CGSPostProcessChain( const uint8_t& _firstStage )
+{
+	firstStage = _firstStage;
+}
+
+CGSPostProcessChain::~CGSPostProcessChain( )
+{
+	GraphicsSystem* graphicsSystem = GraphicsSystem::getGlobalInstance( );
+
+	for( size_t i = 0; i < passes.size( ); ++i )
+	{
+		delete passes[ i ].mesh;
+
+		if( graphicsSystem )
+		{
+			if( passes[ i ].target )
+			{
+				graphicsSystem->deleteRenderTarget( passes[ i ].target );
+			}
+
+			graphicsSystem->removeRenderStage( getPassStage( i ) );
+		}
+	}
+}
+
+CGSMesh* CGSPostProcessChain::addPass(
+		const String& _fragmentShader,
+		const uint8_t& _sizeDivisor,
+		const Source& _source )
+{
+	if( (size_t)firstStage + passes.size( ) > UINT8_MAX )
+	{
+		U::log( "Error: No render stage indexes are left for another post-process pass." );
+		return NULL;
+	}
+
+	GraphicsSystem* graphicsSystem = GraphicsSystem::getGlobalInstance( );
+	CGSMesh* mesh = graphicsSystem->createCompositorMesh( _fragmentShader );
+
+	if( !mesh )
+	{
+		return NULL;
+	}
+
+	passes.push_back( Pass {
+			mesh,
+			U::max( _sizeDivisor, (uint8_t)1 ),
+			_source,
+			CGSRenderStage::SCREEN_TARGET } );
+
+	CGSRenderStage* stage = graphicsSystem->getRenderStage( getPassStage( passes.size( ) - 1 ) );
+	stage->setRetained( true ); // Also removes any operations it had
+	stage->insertOperation( 0, mesh );
+	mesh->programUniform1i( "source", stage->_getBackbufferTextureUnit( ) );
+
+	// The pass before now renders to a target for this one, rather than to the
+	// screen.
+	if( passes.size( ) > 1 )
+	{
+		_connectPass( passes.size( ) - 2 );
+	}
+
+	_connectPass( passes.size( ) - 1 );
+	return mesh;
+}
+
+void CGSPostProcessChain::_connectPass( const size_t& _pass )
+{
+	GraphicsSystem* graphicsSystem = GraphicsSystem::getGlobalInstance( );
+	Pass& pass = passes[ _pass ];
+	CGSRenderStage* stage = graphicsSystem->getRenderStage( getPassStage( _pass ) );
+
+	if( _pass + 1 < passes.size( ) )
+	{
+		if( !pass.target )
+		{
+			pass.target = graphicsSystem->createRenderTarget( pass.sizeDivisor );
+		}
+
+		stage->setOutput( pass.target );
+	}
+	else
+	{
+		stage->setOutput( CGSRenderStage::SCREEN_TARGET );
+	}
+
+	while( !stage->getInputs( ).empty( ) )
+	{
+		stage->removeInput( stage->getInputs( ).front( ).first );
+	}
+
+	// The last pass cannot read the screen as an input, since it renders there;
+	// it gets the screen through the backbuffer on the same unit instead.
+	CGSRenderTargetHandle source = CGSRenderStage::SCREEN_TARGET;
+
+	if( pass.source == Source::PREVIOUS_PASS && _pass )
+	{
+		source = passes[ _pass - 1 ].target;
+	}
+
+	stage->addInput( source, stage->_getBackbufferTextureUnit( ) );
+}
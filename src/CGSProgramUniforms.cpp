@@ -28,7 +28,7 @@ inline GLint _getUniformLocation( GLuint programHandle, const String& name )
 void CGSMesh::programUniform1f( const GLint& location,
 			const GLfloat& v0 )
 {
-	glProgramUniform1f( _getProgramHandle( true ), location, v0 );
+	glProgramUniform1f( _getUniformProgramHandle( ), location, v0 );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -36,7 +36,7 @@ void CGSMesh::programUniform1f( const GLint& location,
 void CGSMesh::programUniform2f( const GLint& location,
 			const GLfloat& v0, const GLfloat& v1 )
 {
-	glProgramUniform2f( _getProgramHandle( true ), location, v0, v1 );
+	glProgramUniform2f( _getUniformProgramHandle( ), location, v0, v1 );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -44,7 +44,7 @@ void CGSMesh::programUniform2f( const GLint& location,
 void CGSMesh::programUniform3f( const GLint& location,
 			const GLfloat& v0, const GLfloat& v1, const GLfloat& v2 )
 {
-	glProgramUniform3f( _getProgramHandle( true ), location, v0, v1, v2 );
+	glProgramUniform3f( _getUniformProgramHandle( ), location, v0, v1, v2 );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -52,7 +52,7 @@ void CGSMesh::programUniform3f( const GLint& location,
 void CGSMesh::programUniform4f( const GLint& location,
 			const GLfloat& v0, const GLfloat& v1, const GLfloat& v2, const GLfloat& v3 )
 {
-	glProgramUniform4f( _getProgramHandle( true ), location, v0, v1, v2, v3 );
+	glProgramUniform4f( _getUniformProgramHandle( ), location, v0, v1, v2, v3 );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -65,7 +65,7 @@ void CGSMesh::programUniform1f( const String& name,
 	// that's why these arguments look a bit weird. Execution order in args is
 	// a bit iffy.
 	glProgramUniform1f( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			v0 );
 }
 
@@ -73,7 +73,7 @@ void CGSMesh::programUniform2f( const String& name,
 			const GLfloat& v0, const GLfloat& v1 )
 {
 	glProgramUniform2f( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			v0, v1 );
 }
 
@@ -81,7 +81,7 @@ void CGSMesh::programUniform3f( const String& name,
 			const GLfloat& v0, const GLfloat& v1, const GLfloat& v2 )
 {
 	glProgramUniform3f( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			v0, v1, v2 );
 }
 
@@ -89,7 +89,7 @@ void CGSMesh::programUniform4f( const String& name,
 			const GLfloat& v0, const GLfloat& v1, const GLfloat& v2, const GLfloat& v3 )
 {
 	glProgramUniform4f( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			v0, v1, v2, v3 );
 }
 
@@ -97,7 +97,7 @@ void CGSMesh::programUniform4f( const String& name,
 void CGSMesh::programUniform1i( const GLint& location,
 			const GLint& v0 )
 {
-	glProgramUniform1i( _getProgramHandle( true ), location, v0 );
+	glProgramUniform1i( _getUniformProgramHandle( ), location, v0 );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -105,7 +105,7 @@ void CGSMesh::programUniform1i( const GLint& location,
 void CGSMesh::programUniform2i( const GLint& location,
 			const GLint& v0, const GLint& v1 )
 {
-	glProgramUniform2i( _getProgramHandle( true ), location, v0, v1 );
+	glProgramUniform2i( _getUniformProgramHandle( ), location, v0, v1 );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -113,7 +113,7 @@ void CGSMesh::programUniform2i( const GLint& location,
 void CGSMesh::programUniform3i( const GLint& location,
 			const GLint& v0, const GLint& v1, const GLint& v2 )
 {
-	glProgramUniform3i( _getProgramHandle( true ), location, v0, v1, v2 );
+	glProgramUniform3i( _getUniformProgramHandle( ), location, v0, v1, v2 );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -121,7 +121,7 @@ void CGSMesh::programUniform3i( const GLint& location,
 void CGSMesh::programUniform4i( const GLint& location,
 			const GLint& v0, const GLint& v1, const GLint& v2, const GLint& v3 )
 {
-	glProgramUniform4i( _getProgramHandle( true ), location, v0, v1, v2, v3 );
+	glProgramUniform4i( _getUniformProgramHandle( ), location, v0, v1, v2, v3 );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -131,7 +131,7 @@ void CGSMesh::programUniform1i( const String& name,
 			const GLint& v0 )
 {
 	glProgramUniform1i( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			v0 );
 }
 
@@ -139,7 +139,7 @@ void CGSMesh::programUniform2i( const String& name,
 			const GLint& v0, const GLint& v1 )
 {
 	glProgramUniform2i( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			v0, v1 );
 }
 
@@ -147,7 +147,7 @@ void CGSMesh::programUniform3i( const String& name,
 			const GLint& v0, const GLint& v1, const GLint& v2 )
 {
 	glProgramUniform3i( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			v0, v1, v2 );
 }
 
@@ -155,7 +155,7 @@ void CGSMesh::programUniform4i( const String& name,
 			const GLint& v0, const GLint& v1, const GLint& v2, const GLint& v3 )
 {
 	glProgramUniform4i( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			v0, v1, v2, v3 );
 }
 
@@ -163,7 +163,7 @@ void CGSMesh::programUniform4i( const String& name,
 void CGSMesh::programUniform1ui( const GLuint& location,
 			const GLuint& v0 )
 {
-	glProgramUniform1ui( _getProgramHandle( true ), location, v0 );
+	glProgramUniform1ui( _getUniformProgramHandle( ), location, v0 );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -171,7 +171,7 @@ void CGSMesh::programUniform1ui( const GLuint& location,
 void CGSMesh::programUniform2ui( const GLuint& location,
 			const GLuint& v0, const GLuint& v1 )
 {
-	glProgramUniform2ui( _getProgramHandle( true ), location, v0, v1 );
+	glProgramUniform2ui( _getUniformProgramHandle( ), location, v0, v1 );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -179,7 +179,7 @@ void CGSMesh::programUniform2ui( const GLuint& location,
 void CGSMesh::programUniform3ui( const GLuint& location,
 			const GLuint& v0, const GLuint& v1, const GLuint& v2 )
 {
-	glProgramUniform3ui( _getProgramHandle( true ), location, v0, v1, v2 );
+	glProgramUniform3ui( _getUniformProgramHandle( ), location, v0, v1, v2 );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -187,7 +187,7 @@ void CGSMesh::programUniform3ui( const GLuint& location,
 void CGSMesh::programUniform4ui( const GLuint& location,
 			const GLuint& v0, const GLuint& v1, const GLuint& v2, const GLuint& v3 )
 {
-	glProgramUniform4ui( _getProgramHandle( true ), location, v0, v1, v2, v3 );
+	glProgramUniform4ui( _getUniformProgramHandle( ), location, v0, v1, v2, v3 );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -197,7 +197,7 @@ void CGSMesh::programUniform1ui( const String& name,
 			const GLuint& v0 )
 {
 	glProgramUniform1ui( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			v0 );
 }
 
@@ -205,7 +205,7 @@ void CGSMesh::programUniform2ui( const String& name,
 			const GLuint& v0, const GLuint& v1 )
 {
 	glProgramUniform2ui( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			v0, v1 );
 }
 
@@ -213,7 +213,7 @@ void CGSMesh::programUniform3ui( const String& name,
 			const GLuint& v0, const GLuint& v1, const GLuint& v2 )
 {
 	glProgramUniform3ui( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			v0, v1, v2 );
 }
 
@@ -221,28 +221,28 @@ void CGSMesh::programUniform4ui( const String& name,
 			const GLuint& v0, const GLuint& v1, const GLuint& v2, const GLuint& v3 )
 {
 	glProgramUniform4ui( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			v0, v1, v2, v3 );
 }
 
 
 void CGSMesh::programUniform2fv( const GLuint& location, const vec2& vector )
 {
-	glProgramUniform2fv( _getProgramHandle( true ), location, 1, vector.d );
+	glProgramUniform2fv( _getUniformProgramHandle( ), location, 1, vector.d );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
 
 void CGSMesh::programUniform3fv( const GLuint& location, const vec3& vector )
 {
-	glProgramUniform3fv( _getProgramHandle( true ), location, 1, vector.d );
+	glProgramUniform3fv( _getUniformProgramHandle( ), location, 1, vector.d );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
 
 void CGSMesh::programUniform4fv( const GLuint& location, const vec4& vector )
 {
-	glProgramUniform4fv( _getProgramHandle( true ), location, 1, vector.d );
+	glProgramUniform4fv( _getUniformProgramHandle( ), location, 1, vector.d );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -250,41 +250,41 @@ void CGSMesh::programUniform4fv( const GLuint& location, const vec4& vector )
 void CGSMesh::programUniform2fv( const String& name, const vec2& vector )
 {
 	glProgramUniform2fv( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			1, vector.d );
 }
 
 void CGSMesh::programUniform3fv( const String& name, const vec3& vector )
 {
 	glProgramUniform3fv( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			1, vector.d );
 }
 
 void CGSMesh::programUniform4fv( const String& name, const vec4& vector )
 {
 	glProgramUniform4fv( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			1, vector.d );
 }
 	
 void CGSMesh::programUniform2iv( const GLuint& location, const ivec2& vector )
 {
-	glProgramUniform2iv( _getProgramHandle( true ), location, 1, vector.d );
+	glProgramUniform2iv( _getUniformProgramHandle( ), location, 1, vector.d );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
 
 void CGSMesh::programUniform3iv( const GLuint& location, const ivec3& vector )
 {
-	glProgramUniform3iv( _getProgramHandle( true ), location, 1, vector.d );
+	glProgramUniform3iv( _getUniformProgramHandle( ), location, 1, vector.d );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
 
 void CGSMesh::programUniform4iv( const GLuint& location, const ivec4& vector )
 {
-	glProgramUniform4iv( _getProgramHandle( true ), location, 1, vector.d );
+	glProgramUniform4iv( _getUniformProgramHandle( ), location, 1, vector.d );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -292,41 +292,41 @@ void CGSMesh::programUniform4iv( const GLuint& location, const ivec4& vector )
 void CGSMesh::programUniform2iv( const String& name, const ivec2& vector )
 {
 	glProgramUniform2iv( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			1, vector.d );
 }
 
 void CGSMesh::programUniform3iv( const String& name, const ivec3& vector )
 {
 	glProgramUniform3iv( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			1, vector.d );
 }
 
 void CGSMesh::programUniform4iv( const String& name, const ivec4& vector )
 {
 	glProgramUniform4iv( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			1, vector.d );
 }
 	
 void CGSMesh::programUniform2uiv( const GLuint& location, const uvec2& vector )
 {
-	glProgramUniform2uiv( _getProgramHandle( true ), location, 1, vector.d );
+	glProgramUniform2uiv( _getUniformProgramHandle( ), location, 1, vector.d );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
 
 void CGSMesh::programUniform3uiv( const GLuint& location, const uvec3& vector )
 {
-	glProgramUniform3uiv( _getProgramHandle( true ), location, 1, vector.d );
+	glProgramUniform3uiv( _getUniformProgramHandle( ), location, 1, vector.d );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
 
 void CGSMesh::programUniform4uiv( const GLuint& location, const uvec4& vector )
 {
-	glProgramUniform4uiv( _getProgramHandle( true ), location, 1, vector.d );
+	glProgramUniform4uiv( _getUniformProgramHandle( ), location, 1, vector.d );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -334,21 +334,21 @@ void CGSMesh::programUniform4uiv( const GLuint& location, const uvec4& vector )
 void CGSMesh::programUniform2uiv( const String& name, const uvec2& vector )
 {
 	glProgramUniform2uiv( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			1, vector.d );
 }
 
 void CGSMesh::programUniform3uiv( const String& name, const uvec3& vector )
 {
 	glProgramUniform3uiv( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			1, vector.d );
 }
 
 void CGSMesh::programUniform4uiv( const String& name, const uvec4& vector )
 {
 	glProgramUniform4uiv( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			1, vector.d );
 }
 
@@ -357,7 +357,7 @@ void CGSMesh::programUniform1fv( const GLuint& location,
 			GLfloat* const& vector,
 			const GLsizei& numOfVectors )
 {
-	glProgramUniform1fv( _getProgramHandle( true ), location, numOfVectors, vector );
+	glProgramUniform1fv( _getUniformProgramHandle( ), location, numOfVectors, vector );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -366,7 +366,7 @@ void CGSMesh::programUniform2fv( const GLuint& location,
 			GLfloat* const& vector,
 			const GLsizei& numOfVectors )
 {
-	glProgramUniform2fv( _getProgramHandle( true ), location, numOfVectors, vector );
+	glProgramUniform2fv( _getUniformProgramHandle( ), location, numOfVectors, vector );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -375,7 +375,7 @@ void CGSMesh::programUniform3fv( const GLuint& location,
 			GLfloat* const& vector,
 			const GLsizei& numOfVectors )
 {
-	glProgramUniform3fv( _getProgramHandle( true ), location, numOfVectors, vector );
+	glProgramUniform3fv( _getUniformProgramHandle( ), location, numOfVectors, vector );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -384,7 +384,7 @@ void CGSMesh::programUniform4fv( const GLuint& location,
 			GLfloat* const& vector,
 			const GLsizei& numOfVectors )
 {
-	glProgramUniform4fv( _getProgramHandle( true ), location, numOfVectors, vector );
+	glProgramUniform4fv( _getUniformProgramHandle( ), location, numOfVectors, vector );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -395,7 +395,7 @@ void CGSMesh::programUniform1fv( const String& name,
 			const GLsizei& numOfVectors )
 {
 	glProgramUniform1fv( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			numOfVectors, vector );
 }
 
@@ -404,7 +404,7 @@ void CGSMesh::programUniform2fv( const String& name,
 			const GLsizei& numOfVectors )
 {
 	glProgramUniform2fv( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			numOfVectors, vector );
 }
 
@@ -413,7 +413,7 @@ void CGSMesh::programUniform3fv( const String& name,
 			const GLsizei& numOfVectors )
 {
 	glProgramUniform3fv( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			numOfVectors, vector );
 }
 
@@ -422,7 +422,7 @@ void CGSMesh::programUniform4fv( const String& name,
 			const GLsizei& numOfVectors )
 {
 	glProgramUniform4fv( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			numOfVectors, vector );
 }
 
@@ -431,7 +431,7 @@ void CGSMesh::programUniform1iv( const GLuint& location,
 			GLint* const& vector,
 			const GLsizei& numOfVectors )
 {
-	glProgramUniform1iv( _getProgramHandle( true ), location, numOfVectors, vector );
+	glProgramUniform1iv( _getUniformProgramHandle( ), location, numOfVectors, vector );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -440,7 +440,7 @@ void CGSMesh::programUniform2iv( const GLuint& location,
 			GLint* const& vector,
 			const GLsizei& numOfVectors )
 {
-	glProgramUniform2iv( _getProgramHandle( true ), location, numOfVectors, vector );
+	glProgramUniform2iv( _getUniformProgramHandle( ), location, numOfVectors, vector );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -449,7 +449,7 @@ void CGSMesh::programUniform3iv( const GLuint& location,
 			GLint* const& vector,
 			const GLsizei& numOfVectors )
 {
-	glProgramUniform3iv( _getProgramHandle( true ), location, numOfVectors, vector );
+	glProgramUniform3iv( _getUniformProgramHandle( ), location, numOfVectors, vector );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -458,7 +458,7 @@ void CGSMesh::programUniform4iv( const GLuint& location,
 			GLint* const& vector,
 			const GLsizei& numOfVectors )
 {
-	glProgramUniform4iv( _getProgramHandle( true ), location, numOfVectors, vector );
+	glProgramUniform4iv( _getUniformProgramHandle( ), location, numOfVectors, vector );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -469,7 +469,7 @@ void CGSMesh::programUniform1iv( const String& name,
 			const GLsizei& numOfVectors )
 {
 	glProgramUniform1iv( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			numOfVectors, vector );
 }
 
@@ -478,7 +478,7 @@ void CGSMesh::programUniform2iv( const String& name,
 			const GLsizei& numOfVectors )
 {
 	glProgramUniform2iv( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			numOfVectors, vector );
 }
 
@@ -487,7 +487,7 @@ void CGSMesh::programUniform3iv( const String& name,
 			const GLsizei& numOfVectors )
 {
 	glProgramUniform3iv( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			numOfVectors, vector );
 }
 
@@ -496,7 +496,7 @@ void CGSMesh::programUniform4iv( const String& name,
 			const GLsizei& numOfVectors )
 {
 	glProgramUniform4iv( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			numOfVectors, vector );
 }
 
@@ -505,7 +505,7 @@ void CGSMesh::programUniform1uiv( const GLuint& location,
 			GLuint* const& vector,
 			const GLsizei& numOfVectors )
 {
-	glProgramUniform1uiv( _getProgramHandle( true ), location, numOfVectors, vector );
+	glProgramUniform1uiv( _getUniformProgramHandle( ), location, numOfVectors, vector );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -514,7 +514,7 @@ void CGSMesh::programUniform2uiv( const GLuint& location,
 			GLuint* const& vector,
 			const GLsizei& numOfVectors )
 {
-	glProgramUniform2uiv( _getProgramHandle( true ), location, numOfVectors, vector );
+	glProgramUniform2uiv( _getUniformProgramHandle( ), location, numOfVectors, vector );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -523,7 +523,7 @@ void CGSMesh::programUniform3uiv( const GLuint& location,
 			GLuint* const& vector,
 			const GLsizei& numOfVectors )
 {
-	glProgramUniform3uiv( _getProgramHandle( true ), location, numOfVectors, vector );
+	glProgramUniform3uiv( _getUniformProgramHandle( ), location, numOfVectors, vector );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -532,7 +532,7 @@ void CGSMesh::programUniform4uiv( const GLuint& location,
 			GLuint* const& vector,
 			const GLsizei& numOfVectors )
 {
-	glProgramUniform4uiv( _getProgramHandle( true ), location, numOfVectors, vector );
+	glProgramUniform4uiv( _getUniformProgramHandle( ), location, numOfVectors, vector );
 	
 	MISSING_UNIFORM_ERROR_SUPPRESSION( );
 }
@@ -543,7 +543,7 @@ void CGSMesh::programUniform1uiv( const String& name,
 			const GLsizei& numOfVectors )
 {
 	glProgramUniform1uiv( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			numOfVectors, vector );
 }
 
@@ -552,7 +552,7 @@ void CGSMesh::programUniform2uiv( const String& name,
 			const GLsizei& numOfVectors )
 {
 	glProgramUniform2uiv( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			numOfVectors, vector );
 }
 
@@ -561,7 +561,7 @@ void CGSMesh::programUniform3uiv( const String& name,
 			const GLsizei& numOfVectors )
 {
 	glProgramUniform3uiv( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			numOfVectors, vector );
 }
 
@@ -570,6 +570,6 @@ void CGSMesh::programUniform4uiv( const String& name,
 			const GLsizei& numOfVectors )
 {
 	glProgramUniform4uiv( programHandle,
-			_getUniformLocation( _getProgramHandle( true ), name ),
+			_getUniformLocation( _getUniformProgramHandle( ), name ),
 			numOfVectors, vector );
 }
\ No newline at end of file
@@ -16,113 +16,1924 @@
 #include "CGSMesh.h"
 #include "CGSShader.h"
 #include "CGSTexture.h"
+#include "CGSMultiDrawPool.h"
+#include "CGSRadixSort.h"
 
 const uint8_t CGSRenderStage::DEFAULT_BACK_BUFFER_TEXTURE_UNIT = 7;
+const CGSRenderOperationHandle CGSRenderStage::INVALID_OPERATION_HANDLE = 0;
+const CGSRenderTargetHandle CGSRenderStage::SCREEN_TARGET = 0;
 
-void CGSRenderStage::insertOperation(
+// How many frames in a row a pooled render target may go unused before it is
+// released.
+const uint8_t RENDER_TARGET_POOL_KEEP_FRAMES = 3;
+
+static_assert( sizeof( CGSRenderOrderingType ) <= sizeof( uint32_t ),
+		"CGSRenderOrderingType must fit in the upper 32 bits of the sort key." );
+
+uint64_t CGSRenderStage::_generateSortKey(
+		const CGSRenderOrderingType& _position,
+		const CGSRenderOperation& _operation )
+{
+	CGSMesh* mesh = _operation.mesh;
+	uint32_t ordering = _orderingToKey( _position );
+	
+	// Back to front.
+	if( _operation.renderClass == CGSRenderClass::TRANSLUCENT )
+	{
+		ordering = ~ordering;
+	}
+	
+	return ( (uint64_t)_operation.renderClass << 62 )
+			| ( (uint64_t)ordering << 30 )
+			| ( (uint64_t)( mesh->_getProgramHandle( ) & 0x7FF ) << 19 )
+			| ( (uint64_t)( mesh->_getTextureSetKey( ) & 0x1FF ) << 10 )
+			| ( (uint64_t)( mesh->_getVAOHandle( ) & 0x3FF ) );
+}
+
+void CGSRenderStage::setRetained( const bool& _retained )
+{
+	if( retained == _retained )
+	{
+		return;
+	}
+	
+	clearOperations( );
+	retained = _retained;
+}
+
+CGSRenderOperationHandle CGSRenderStage::insertOperation(
 		const CGSRenderOrderingType& _position,
 		CGSMesh* const& _mesh,
-		const bool& _pullBackbuffer )
+		const bool& _pullBackbuffer,
+		const CGSScreenRegion& _region,
+		const CGSRenderClass& _renderClass )
+{
+	CGSRenderOperation operation( _mesh, _pullBackbuffer, 0, 0, _region, _renderClass );
+	
+	if( !retained )
+	{
+		commands.push_back( CGSRenderCommand(
+				_generateSortKey( _position, operation ),
+				operation ) );
+		
+		return INVALID_OPERATION_HANDLE;
+	}
+	
+	CGSRenderOperationHandle handle = nextOperationHandle++;
+	retainedOperations.insert( U::p( handle,
+			RetainedOperation {
+					_position,
+					operation,
+					Array< float >( ) } ) );
+	commandsDirty = true;
+	
+	return handle;
+}
+
+CGSRenderOperationHandle CGSRenderStage::insertOperation(
+		const CGSRenderOrderingType& _position,
+		CGSMesh* const& _mesh,
+		const float* const& _instanceData,
+		const uint8_t& _instanceDataSize,
+		const bool& _pullBackbuffer,
+		const CGSScreenRegion& _region,
+		const CGSRenderClass& _renderClass )
+{
+	CGSRenderOperation operation( _mesh, _pullBackbuffer, _instanceDataSize, 0, _region, _renderClass );
+	
+	if( !retained )
+	{
+		operation.instanceDataOffset = instanceData.size( );
+		commands.push_back( CGSRenderCommand(
+				_generateSortKey( _position, operation ),
+				operation ) );
+		instanceData.insert( instanceData.end( ), _instanceData, _instanceData + _instanceDataSize );
+		
+		return INVALID_OPERATION_HANDLE;
+	}
+	
+	CGSRenderOperationHandle handle = nextOperationHandle++;
+	retainedOperations.insert( U::p( handle,
+			RetainedOperation {
+					_position,
+					operation,
+					Array< float >( _instanceData, _instanceData + _instanceDataSize ) } ) );
+	commandsDirty = true;
+	
+	return handle;
+}
+
+bool CGSRenderStage::removeOperation( const CGSRenderOperationHandle& _handle )
+{
+	if( retainedOperations.erase( _handle ) )
+	{
+		commandsDirty = true;
+		return true;
+	}
+	
+	return false;
+}
+
+bool CGSRenderStage::reorderOperation(
+		const CGSRenderOperationHandle& _handle,
+		const CGSRenderOrderingType& _position )
+{
+	auto i = retainedOperations.find( _handle );
+	
+	if( i == retainedOperations.end( ) )
+	{
+		return false;
+	}
+	
+	i->second.position = _position;
+	commandsDirty = true;
+	return true;
+}
+
+void CGSRenderStage::submitCommandList(
+		CGSRenderCommandList& _list,
+		Array< CGSRenderOperationHandle >* const& _handles )
+{
+	const Array< Pair< CGSRenderOrderingType, CGSRenderOperation > >& operations
+			= _list._getOperations( );
+	const Array< float >& listInstanceData = _list._getInstanceData( );
+	
+	if( !retained )
+	{
+		// The list's instance data is appended whole, so offsets only need
+		// shifting by where it starts.
+		uint32_t instanceDataBase = instanceData.size( );
+		instanceData.insert( instanceData.end( ), listInstanceData.begin( ), listInstanceData.end( ) );
+		
+		for( auto i = operations.begin( ); i != operations.end( ); ++i )
+		{
+			CGSRenderOperation operation = i->second;
+			operation.instanceDataOffset += instanceDataBase;
+			
+			commands.push_back( CGSRenderCommand(
+					_generateSortKey( i->first, operation ),
+					operation ) );
+		}
+	}
+	else
+	{
+		for( auto i = operations.begin( ); i != operations.end( ); ++i )
+		{
+			CGSRenderOperationHandle handle = insertOperation(
+					i->first,
+					i->second.mesh,
+					listInstanceData.data( ) + i->second.instanceDataOffset,
+					i->second.instanceDataSize,
+					i->second.pullBackbuffer,
+					i->second.region,
+					i->second.renderClass );
+			
+			if( _handles )
+			{
+				_handles->push_back( handle );
+			}
+		}
+	}
+	
+	_list.clear( );
+}
+
+void CGSRenderStage::addInput( const CGSRenderTargetHandle& _target, const uint8_t& _unit )
+{
+	for( auto i = inputs.begin( ); i != inputs.end( ); ++i )
+	{
+		if( i->first == _target )
+		{
+			i->second = _unit;
+			return;
+		}
+	}
+	
+	inputs.push_back( U::p( _target, _unit ) );
+}
+
+bool CGSRenderStage::removeInput( const CGSRenderTargetHandle& _target )
+{
+	for( auto i = inputs.begin( ); i != inputs.end( ); ++i )
+	{
+		if( i->first == _target )
+		{
+			inputs.erase( i );
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+void CGSRenderStage::clearOperations( )
+{
+	commands.clear( );
+	retainedOperations.clear( );
+	instanceData.clear( );
+	sortedInstanceData.clear( );
+	commandsDirty = false;
+}
+
+void CGSRenderStage::_endFrame( )
+{
+	if( !retained )
+	{
+		commands.clear( );
+		instanceData.clear( );
+	}
+}
+
+void CGSRenderStage::_removeMesh( CGSMesh* const& _mesh )
+{
+	for( auto i = retainedOperations.begin( ); i != retainedOperations.end( ); )
+	{
+		if( i->second.operation.mesh == _mesh )
+		{
+			i = retainedOperations.erase( i );
+			commandsDirty = true;
+		}
+		else
+		{
+			++i;
+		}
+	}
+	
+	// Immediate operations inserted this frame can refer to the mesh as well.
+	if( !retained )
+	{
+		commands.erase( std::remove_if( commands.begin( ), commands.end( ),
+				[ &_mesh ]( const CGSRenderCommand& command )
+				{
+					return command.operation.mesh == _mesh;
+				} ), commands.end( ) );
+	}
+}
+
+void CGSRenderStage::_sortCommands( )
+{
+	if( !retained )
+	{
+		_radixSortCommands( );
+		_packInstanceData( );
+		return;
+	}
+	
+	if( !commandsDirty )
+	{
+		return;
+	}
+	
+	// Keys are regenerated on rebuild, which also picks up state changes to the
+	// meshes of operations which did not themselves change.
+	commands.clear( );
+	commands.reserve( retainedOperations.size( ) );
+	instanceData.clear( );
+	
+	for( auto i = retainedOperations.begin( ); i != retainedOperations.end( ); ++i )
+	{
+		CGSRenderOperation operation = i->second.operation;
+		operation.instanceDataOffset = instanceData.size( );
+		instanceData.insert( instanceData.end( ),
+				i->second.instanceData.begin( ), i->second.instanceData.end( ) );
+		
+		commands.push_back( CGSRenderCommand(
+				_generateSortKey( i->second.position, operation ),
+				operation ) );
+	}
+	
+	_radixSortCommands( );
+	_packInstanceData( );
+	commandsDirty = false;
+}
+
+void CGSRenderStage::_packInstanceData( )
+{
+	sortedInstanceData.clear( );
+	
+	for( auto i = commands.begin( ); i != commands.end( ); ++i )
+	{
+		CGSRenderOperation& operation = i->operation;
+		uint8_t size = operation.mesh->getInstanceDataSize( );
+		
+		if( !size )
+		{
+			continue;
+		}
+		
+		// Missing data is left as zero.
+		uint32_t offset = sortedInstanceData.size( );
+		sortedInstanceData.resize( offset + size, 0.0f );
+		
+		if( operation.instanceDataSize )
+		{
+			memcpy( sortedInstanceData.data( ) + offset,
+					instanceData.data( ) + operation.instanceDataOffset,
+					U::min( operation.instanceDataSize, size ) * sizeof( float ) );
+		}
+		
+		operation.instanceDataSize = size;
+		operation.instanceDataOffset = offset;
+	}
+	
+	// The unsorted data is no longer referred to by any command.
+	instanceData.clear( );
+}
+
+size_t CGSRenderStage::_findInstanceRunEnd( const size_t& _start ) const
+{
+	CGSMesh* mesh = commands[ _start ].operation.mesh;
+	CGSRenderClass renderClass = commands[ _start ].operation.renderClass;
+	size_t end = _start + 1;
+	
+	while( end < commands.size( )
+			&& commands[ end ].operation.mesh == mesh
+			&& commands[ end ].operation.renderClass == renderClass
+			&& !commands[ end ].operation.pullBackbuffer )
+	{
+		++end;
+	}
+	
+	return end;
+}
+
+CGSScreenRegion CGSRenderStage::_findPullRegion( const size_t& _start ) const
+{
+	CGSScreenRegion region;
+	
+	for( size_t i = _start; i < commands.size( ); ++i )
+	{
+		const CGSRenderOperation& operation = commands[ i ].operation;
+		
+		if( i != _start && operation.pullBackbuffer )
+		{
+			break;
+		}
+		
+		const CGSScreenRegion& operationRegion = operation.region.isKnown( )
+				? operation.region
+				: operation.mesh->getScreenBounds( );
+		
+		if( !operationRegion.isKnown( ) )
+		{
+			return CGSScreenRegion( );
+		}
+		
+		if( region.isKnown( ) )
+		{
+			region.merge( operationRegion );
+		}
+		else
+		{
+			region = operationRegion;
+		}
+	}
+	
+	return region;
+}
+
+// FNV-1a over _size bytes at _data, continuing from _hash.
+inline void _hashBytes( uint64_t& _hash, const void* const& _data, const size_t& _size )
+{
+	const uint8_t* bytes = (const uint8_t*)_data;
+	
+	for( size_t i = 0; i < _size; ++i )
+	{
+		_hash = ( _hash ^ bytes[ i ] ) * 1099511628211ULL;
+	}
+}
+
+bool CGSRenderStage::_findCommandDamage( CGSScreenRegion& _damage )
+{
+	uint64_t signature = 14695981039346656037ULL;
+	CGSScreenRegion bounds;
+	bool coversNothing = commands.empty( );
+	bool boundsUnknown = false;
+	
+	_hashBytes( signature, &output, sizeof( output ) );
+	_hashBytes( signature, &resolutionDivisor, sizeof( resolutionDivisor ) );
+	
+	for( auto i = inputs.begin( ); i != inputs.end( ); ++i )
+	{
+		_hashBytes( signature, &i->first, sizeof( i->first ) );
+		_hashBytes( signature, &i->second, sizeof( i->second ) );
+	}
+	
+	for( auto i = commands.begin( ); i != commands.end( ); ++i )
+	{
+		const CGSRenderOperation& operation = i->operation;
+		_hashBytes( signature, &i->key, sizeof( i->key ) );
+		_hashBytes( signature, &operation.mesh, sizeof( operation.mesh ) );
+		_hashBytes( signature, &operation.pullBackbuffer, sizeof( operation.pullBackbuffer ) );
+		_hashBytes( signature, &operation.region, sizeof( operation.region ) );
+		
+		const CGSScreenRegion& operationRegion = operation.region.isKnown( )
+				? operation.region
+				: operation.mesh->getScreenBounds( );
+		
+		if( !operationRegion.isKnown( ) )
+		{
+			boundsUnknown = true;
+		}
+		else if( bounds.isKnown( ) )
+		{
+			bounds.merge( operationRegion );
+		}
+		else
+		{
+			bounds = operationRegion;
+		}
+	}
+	
+	if( !sortedInstanceData.empty( ) )
+	{
+		_hashBytes( signature,
+				sortedInstanceData.data( ),
+				sortedInstanceData.size( ) * sizeof( float ) );
+	}
+	
+	if( boundsUnknown )
+	{
+		bounds = CGSScreenRegion( );
+	}
+	
+	if( signature == damageSignature )
+	{
+		return false;
+	}
+	
+	// Unknown bounds on either side damage the whole screen.
+	if( damageCoversNothing )
+	{
+		_damage = bounds;
+	}
+	else if( coversNothing )
+	{
+		_damage = damageBounds;
+	}
+	else
+	{
+		_damage = bounds;
+		
+		if( _damage.isKnown( ) && damageBounds.isKnown( ) )
+		{
+			_damage.merge( damageBounds );
+		}
+		else
+		{
+			_damage = CGSScreenRegion( );
+		}
+	}
+	
+	damageSignature = signature;
+	damageBounds = bounds;
+	damageCoversNothing = coversNothing;
+	return true;
+}
+
+void CGSRenderStage::_radixSortCommands( )
+{
+	radixSortByKey( commands, sortBuffer );
+}
+
+
+CGSMesh* GraphicsSystem::createCompositorMesh( const String& fragmentShader )
+{
+	assert( inititalized );
+	
+	if( fragmentShader.empty( ) )
+	{
+		U::log( "Error: createCompositorMesh( ) requires a fragment shader." );
+		return NULL;
+	}
+	
+	// The built-in vertex shader is only used if no file was loaded under the
+	// same name first.
+	auto vertexShader = loadedShaders.find( U::p( ShaderType::VERTEX, String( COMPOSITOR_SHADER_NAME ) ) );
+	
+	if( vertexShader == loadedShaders.end( ) )
+	{
+		CGSShader* shader = new CGSShader( ShaderType::VERTEX );
+		
+		if( !shader->build( COMPOSITOR_VERTEX_SHADER_SOURCE ) )
+		{
+			// CGSShader will print an error on build failure.
+			delete shader;
+			return NULL;
+		}
+		
+		vertexShader = loadedShaders.insert(
+				U::p( U::p( ShaderType::VERTEX, String( COMPOSITOR_SHADER_NAME ) ), shader ) ).first;
+	}
+	
+	// One triangle covering the screen has no seam down the diagonal, unlike a
+	// pair of triangles, so no fragments are shaded twice.
+	CGSMesh* mesh = createMesh( GL_TRIANGLES );
+	mesh->_makeAttributeless( emptyVAOHandle, 3 );
+	
+	if( !mesh->attachVertexShader( vertexShader->second )
+			|| !mesh->loadFragmentShader( fragmentShader ) )
+	{
+		delete mesh;
+		return NULL;
+	}
+	
+	// Nothing is linked yet, so the location is found on the first frame.
+	CompositorUniforms uniforms;
+	uniforms.program = 0;
+	uniforms.linkCount = 0;
+	uniforms.resolutionScaleLocation = -1;
+	compositorMeshes.insert( U::p( mesh, uniforms ) );
+	return mesh;
+}
+
+CGSRenderStage* GraphicsSystem::getRenderStage( const uint8_t& index )
+{
+	return &renderStages[ index ];
+}
+
+bool GraphicsSystem::removeRenderStage( const uint8_t& index )
+{
+	_releaseStageTarget( index );
+	_deleteStageCache( index );
+	return renderStages.erase( index );
+}
+
+bool GraphicsSystem::setMultiDrawIndirect( const bool& _enabled )
+{
+	if( _enabled && !isOpenGLVersionSupported( 4, 3 )
+			&& !( isExtensionSupported( "GL_ARB_multi_draw_indirect" )
+				&& isExtensionSupported( "GL_ARB_base_instance" ) ) )
+	{
+		U::log( "Warning: Multi-draw indirect requires OpenGL 4.3 or GL_ARB_multi_draw_indirect and GL_ARB_base_instance, which are not supported. It remains disabled." );
+		multiDrawIndirect = false;
+		return false;
+	}
+	
+	multiDrawIndirect = _enabled;
+	return true;
+}
+
+size_t GraphicsSystem::_findMultiDrawEnd(
+		CGSRenderStage& _stage,
+		const size_t& _start,
+		const size_t& _runEnd )
+{
+	Array< CGSRenderCommand >& commands = _stage._getCommands( );
+	CGSMesh* mesh = commands[ _start ].operation.mesh;
+	CGSRenderClass renderClass = commands[ _start ].operation.renderClass;
+	size_t end = _runEnd;
+	
+	while( end < commands.size( )
+			&& !commands[ end ].operation.pullBackbuffer
+			&& commands[ end ].operation.renderClass == renderClass
+			&& mesh->_canMultiDrawWith( commands[ end ].operation.mesh ) )
+	{
+		end = _stage._findInstanceRunEnd( end );
+	}
+	
+	return end;
+}
+
+void GraphicsSystem::_renderOcclusionTested(
+		CGSMesh* const& _mesh,
+		const GLsizei& _instanceCount,
+		const GLintptr& _instanceBufferOffset,
+		const bool& _depthWrites )
+{
+	uint64_t frame = frameSync.getFrameNumber( );
+	GLuint previous = frame ? _mesh->_getOcclusionQuery( frame - 1 ) : 0;
+	
+	// Only the first operation on the mesh in a frame is tested, and the rest
+	// are drawn the same way.
+	if( !_mesh->_getOcclusionQuery( frame ) )
+	{
+		CGSOcclusionPlan plan = planOcclusionDraw(
+				previous != 0,
+				frame && _mesh->_wasDrawnConditionally( frame - 1 ),
+				damageTracking );
+		
+		if( plan.conditional )
+		{
+			_mesh->_setDrawnConditionally( frame );
+		}
+		
+		// Damage added while rendering is redrawn by the next frame.
+		if( plan.damageNextFrame )
+		{
+			addDamage( _mesh->getScreenBounds( ) );
+		}
+		
+		glColorMask( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
+		
+		if( _depthWrites )
+		{
+			glDepthMask( GL_FALSE );
+		}
+		
+		glBeginQuery( GL_ANY_SAMPLES_PASSED, _mesh->_startOcclusionQuery( frame ) );
+		_mesh->getOcclusionProxy( )->_render( _instanceCount, instanceBufferHandle, _instanceBufferOffset );
+		glEndQuery( GL_ANY_SAMPLES_PASSED );
+		
+		glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
+		
+		if( _depthWrites )
+		{
+			glDepthMask( GL_TRUE );
+		}
+	}
+	
+	// Without a result from the frame before, the mesh is drawn regardless. So
+	// it is if that result is somehow not ready yet, rather than stalling.
+	bool conditional = _mesh->_wasDrawnConditionally( frame );
+	
+	if( conditional )
+	{
+		glBeginConditionalRender( previous, GL_QUERY_NO_WAIT );
+	}
+	
+	_mesh->_render( _instanceCount, instanceBufferHandle, _instanceBufferOffset );
+	
+	if( conditional )
+	{
+		glEndConditionalRender( );
+	}
+}
+
+void GraphicsSystem::_renderMultiDraw(
+		CGSRenderStage& _stage,
+		const size_t& _start,
+		const size_t& _end,
+		const size_t& _instanceDataBase )
+{
+	Array< CGSRenderCommand >& commands = _stage._getCommands( );
+	const CGSRenderOperation& firstOperation = commands[ _start ].operation;
+	CGSMesh* firstMesh = firstOperation.mesh;
+	
+	CGSMultiDrawPool*& pool = multiDrawPools[ firstMesh->_getVertexFormatKey( ) ];
+	
+	if( !pool )
+	{
+		pool = new CGSMultiDrawPool( firstMesh );
+	}
+	
+	// Every mesh must be in the pool before any slot is read, since adding one
+	// can move the others.
+	for( size_t j = _start; j < _end; j = _stage._findInstanceRunEnd( j ) )
+	{
+		CGSMesh* mesh = commands[ j ].operation.mesh;
+		
+		if( mesh->_needsUpdate( ) )
+		{
+			mesh->_update( );
+		}
+		
+		pool->_prepareMesh( mesh );
+	}
+	
+	// One command per run of the same mesh. Instance attributes are pointed at
+	// the data of the first operation, and each run picks out its own data with
+	// baseInstance. All meshes here have the same instance layout, and their
+	// data is packed contiguously in command order, so this always divides.
+	bool indexed = firstMesh->_usesIndexes( );
+	uint8_t instanceDataSize = firstMesh->getInstanceDataSize( );
+	GLsizei drawCount = 0;
+	indirectCommands.clear( );
+	
+	for( size_t j = _start; j < _end; ++drawCount )
+	{
+		const CGSRenderOperation& operation = commands[ j ].operation;
+		const CGSMultiDrawPool::Slot& slot = pool->_getSlot( operation.mesh );
+		size_t runEnd = _stage._findInstanceRunEnd( j );
+		
+		GLuint baseInstance = instanceDataSize
+				? ( operation.instanceDataOffset - firstOperation.instanceDataOffset ) / instanceDataSize
+				: 0;
+		
+		if( indexed )
+		{
+			// DrawElementsIndirectCommand
+			indirectCommands.push_back( operation.mesh->_getIndexCount( ) );
+			indirectCommands.push_back( runEnd - j );
+			indirectCommands.push_back( slot.firstIndex );
+			indirectCommands.push_back( slot.firstVertex ); // baseVertex
+			indirectCommands.push_back( baseInstance );
+		}
+		else
+		{
+			// DrawArraysIndirectCommand
+			indirectCommands.push_back( operation.mesh->_getVertexCount( ) );
+			indirectCommands.push_back( runEnd - j );
+			indirectCommands.push_back( slot.firstVertex );
+			indirectCommands.push_back( baseInstance );
+		}
+		
+		j = runEnd;
+	}
+	
+	// Textures and program are the same for every mesh in the draw.
+	firstMesh->_bindTextures( );
+	stateCache.useProgram( firstMesh->_getProgramHandle( ) );
+	stateCache.bindVertexArray( pool->_getVAOHandle( ) );
+	
+	if( instanceDataSize )
+	{
+		firstMesh->_setInstanceAttributePointers(
+				instanceBufferHandle,
+				( _instanceDataBase + firstOperation.instanceDataOffset ) * sizeof( float ) );
+	}
+	
+	glBindBuffer( GL_DRAW_INDIRECT_BUFFER, indirectBufferHandle );
+	glBufferData( GL_DRAW_INDIRECT_BUFFER,
+			indirectCommands.size( ) * sizeof( GLuint ),
+			indirectCommands.data( ),
+			GL_STREAM_DRAW );
+	
+	if( indexed )
+	{
+		glMultiDrawElementsIndirect( firstMesh->_getRenderOperation( ), GL_UNSIGNED_INT, 0, drawCount, 0 );
+	}
+	else
+	{
+		glMultiDrawArraysIndirect( firstMesh->_getRenderOperation( ), 0, drawCount, 0 );
+	}
+	
+	glBindBuffer( GL_DRAW_INDIRECT_BUFFER, 0 );
+}
+
+void GraphicsSystem::_pullBackbuffer(
+		const uint8_t& _unit,
+		const CGSScreenRegion& _region )
+{
+	if( backbufferStrategy == BackbufferStrategy::TEXTURE_BARRIER )
+	{
+		// The render target is the backbuffer. The barrier makes everything drawn
+		// so far visible to texture fetches from it.
+		stateCache.bindTexture( _unit, GL_TEXTURE_2D, framebufferInternalTextureHandle );
+		
+		if( useNVTextureBarrier )
+		{
+			glTextureBarrierNV( );
+		}
+		else
+		{
+			glTextureBarrier( );
+		}
+		
+		return;
+	}
+	
+	// Only the part of the target rendered to at the current scale is copied.
+	uint16_t x = 0;
+	uint16_t y = 0;
+	uint16_t width = renderX;
+	uint16_t height = renderY;
+	
+	if( _region.isKnown( ) )
+	{
+		CGSScreenRegion region = _scaleRegion( _region );
+		x = U::min( region.x, renderX );
+		y = U::min( region.y, renderY );
+		width = U::min( region.width, (uint16_t)( renderX - x ) );
+		height = U::min( region.height, (uint16_t)( renderY - y ) );
+	}
+	
+	stateCache.bindTexture( _unit, GL_TEXTURE_2D, backbufferTextureHandle );
+	stateCache.bindFramebuffer( GL_READ_FRAMEBUFFER, framebufferHandle );
+	glCopyTexSubImage2D(
+			GL_TEXTURE_2D,
+			0, // level
+			x, y, // offset
+			x, y, // x, y
+			width, height );
+	stateCache.bindFramebuffer( GL_DRAW_FRAMEBUFFER, framebufferHandle );
+}
+
+void GraphicsSystem::render( )
+{
+	assert( inititalized );
+	
+	_startFrame( );
+	_renderStages( _buildRenderGraph( ) );
+}
+
+void GraphicsSystem::render( const Array< uint8_t >& stagesToRender )
+{
+	assert( inititalized );
+	
+	_startFrame( );
+	_renderStages( stagesToRender );
+}
+
+void GraphicsSystem::waitForFrameStart( )
+{
+	assert( inititalized );
+	
+	if( frameStarted )
+	{
+		return;
+	}
+	
+	// Wait here, if the GPU is too far behind, rather than in the middle of
+	// the frame on a buffer it is still reading.
+	frameSync._beginFrame( );
+	_readFrameQueries( );
+	
+	if( frameInterval.count( ) )
+	{
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now( );
+		
+		if( now < nextFrameTime )
+		{
+			// SDL_Delay( ) only has millisecond precision and may oversleep, so
+			// the last millisecond is spun.
+			int64_t sleep = std::chrono::duration_cast< std::chrono::milliseconds >(
+					nextFrameTime - now ).count( );
+			
+			if( sleep > 1 )
+			{
+				SDL_Delay( (uint32_t)( sleep - 1 ) );
+			}
+			
+			while( now < nextFrameTime )
+			{
+				now = std::chrono::steady_clock::now( );
+			}
+		}
+		
+		// A frame more than an interval late restarts the schedule, rather than
+		// letting the frames after it run unlimited to catch up.
+		if( now - nextFrameTime > frameInterval )
+		{
+			nextFrameTime = now;
+		}
+		
+		nextFrameTime += frameInterval;
+	}
+	
+	// The GL clock, so it can be compared with the timestamp of the swap.
+	glGetInteger64v( GL_TIMESTAMP, &frameStartTime );
+	frameStarted = true;
+}
+
+void GraphicsSystem::_startFrame( )
+{
+	waitForFrameStart( );
+	frameStarted = false;
+	
+	if( lateLatchCallback )
+	{
+		lateLatchCallback( );
+	}
+}
+
+void GraphicsSystem::_readFrameQueries( )
+{
+	uint8_t slot = frameSync.getFrameSlot( );
+	GLuint available = GL_FALSE;
+	
+	if( latencyQueriesPending[ slot ] )
+	{
+		glGetQueryObjectuiv( latencyQueries[ slot ], GL_QUERY_RESULT_AVAILABLE, &available );
+		
+		if( available )
+		{
+			GLuint64 swapTime = 0;
+			glGetQueryObjectui64v( latencyQueries[ slot ], GL_QUERY_RESULT, &swapTime );
+			frameLatency = (double)( (GLint64)swapTime - latencyFrameStarts[ slot ] ) / 1000000.0;
+			latencyQueriesPending[ slot ] = false;
+		}
+	}
+	
+	if( gpuTimeQueriesPending[ slot ] )
+	{
+		glGetQueryObjectuiv( gpuTimeQueries[ slot ], GL_QUERY_RESULT_AVAILABLE, &available );
+		
+		if( available )
+		{
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v( gpuTimeQueries[ slot ], GL_QUERY_RESULT, &elapsed );
+			gpuFrameTime = (double)elapsed / 1000000.0;
+			gpuTimeQueriesPending[ slot ] = false;
+			_updateDynamicResolution( );
+		}
+	}
+}
+
+CGSRenderTargetHandle GraphicsSystem::createRenderTarget(
+		const uint8_t& _sizeDivisor,
+		const GLenum& _internalFormat )
+{
+	CGSRenderTargetHandle handle = nextRenderTargetHandle++;
+	renderTargets[ handle ] = RenderTarget { U::max( _sizeDivisor, (uint8_t)1 ), _internalFormat };
+	return handle;
+}
+
+bool GraphicsSystem::deleteRenderTarget( const CGSRenderTargetHandle& _target )
+{
+	if( !renderTargets.erase( _target ) )
+	{
+		return false;
+	}
+	
+	for( auto i = renderStages.begin( ); i != renderStages.end( ); ++i )
+	{
+		i->second.removeInput( _target );
+	}
+	
+	return true;
+}
+
+Array< uint8_t > GraphicsSystem::_buildRenderGraph( )
+{
+	// Every stage writing a target must come before every stage reading it.
+	// Otherwise stages keep their index order, so without targets nothing
+	// changes from rendering every stage in order.
+	AssocArray< uint8_t, uint16_t > dependencyCount;
+	AssocArray< uint8_t, Array< uint8_t > > dependents;
+	
+	for( auto i = renderStages.begin( ); i != renderStages.end( ); ++i )
+	{
+		dependencyCount[ i->first ] = 0;
+	}
+	
+	for( auto reader = renderStages.begin( ); reader != renderStages.end( ); ++reader )
+	{
+		const Array< Pair< CGSRenderTargetHandle, uint8_t > >& inputs = reader->second.getInputs( );
+		
+		for( auto input = inputs.begin( ); input != inputs.end( ); ++input )
+		{
+			for( auto writer = renderStages.begin( ); writer != renderStages.end( ); ++writer )
+			{
+				// Like the backbuffer, reading the screen target means reading what
+				// the stages before the reader rendered there, not the later ones.
+				if( input->first == CGSRenderStage::SCREEN_TARGET && writer->first > reader->first )
+				{
+					continue;
+				}
+				
+				if( writer != reader && writer->second.getOutput( ) == input->first )
+				{
+					dependents[ writer->first ].push_back( reader->first );
+					++dependencyCount[ reader->first ];
+				}
+			}
+		}
+	}
+	
+	// Topological sort, always taking the lowest ready index first.
+	OrderedSet< uint8_t > ready;
+	for( auto i = dependencyCount.begin( ); i != dependencyCount.end( ); ++i )
+	{
+		if( !i->second )
+		{
+			ready.insert( i->first );
+		}
+	}
+	
+	Array< uint8_t > order;
+	order.reserve( renderStages.size( ) );
+	
+	while( !ready.empty( ) )
+	{
+		uint8_t stage = *ready.begin( );
+		ready.erase( ready.begin( ) );
+		order.push_back( stage );
+		
+		Array< uint8_t >& stageDependents = dependents[ stage ];
+		for( auto i = stageDependents.begin( ); i != stageDependents.end( ); ++i )
+		{
+			if( !--dependencyCount[ *i ] )
+			{
+				ready.insert( *i );
+			}
+		}
+	}
+	
+	if( order.size( ) != renderStages.size( ) )
+	{
+		U::log( "Warning: Render stages read each other's targets in a cycle. The stages involved are rendered in index order." );
+		
+		for( auto i = dependencyCount.begin( ); i != dependencyCount.end( ); ++i )
+		{
+			if( i->second )
+			{
+				order.push_back( i->first );
+			}
+		}
+	}
+	
+	// Cull stages whose output nothing reads. Walking backwards, a target is
+	// needed if a later kept stage reads it; the screen always is.
+	UnorderedSet< CGSRenderTargetHandle > neededTargets;
+	neededTargets.insert( CGSRenderStage::SCREEN_TARGET );
+	
+	Array< uint8_t > kept;
+	kept.reserve( order.size( ) );
+	
+	for( auto i = order.rbegin( ); i != order.rend( ); ++i )
+	{
+		CGSRenderStage& stage = renderStages.find( *i )->second;
+		
+		if( !neededTargets.count( stage.getOutput( ) ) )
+		{
+			continue;
+		}
+		
+		kept.push_back( *i );
+		
+		const Array< Pair< CGSRenderTargetHandle, uint8_t > >& inputs = stage.getInputs( );
+		for( auto input = inputs.begin( ); input != inputs.end( ); ++input )
+		{
+			neededTargets.insert( input->first );
+		}
+	}
+	
+	std::reverse( kept.begin( ), kept.end( ) );
+	return kept;
+}
+
+void GraphicsSystem::_allocateRenderTargets(
+		const Array< uint8_t >& _order,
+		AssocArray< CGSRenderTargetHandle, size_t >& _assignments )
+{
+	// The first and last position in _order at which each target is used.
+	AssocArray< CGSRenderTargetHandle, Pair< size_t, size_t > > lifetimes;
+	
+	for( size_t p = 0; p < _order.size( ); ++p )
+	{
+		auto stage = renderStages.find( _order[ p ] );
+		
+		if( stage == renderStages.end( ) )
+		{
+			continue;
+		}
+		
+		Array< CGSRenderTargetHandle > used( 1, _getStageTarget( stage->first, stage->second ) );
+		const Array< Pair< CGSRenderTargetHandle, uint8_t > >& inputs = stage->second.getInputs( );
+		for( auto input = inputs.begin( ); input != inputs.end( ); ++input )
+		{
+			used.push_back( input->first );
+		}
+		
+		for( auto target = used.begin( ); target != used.end( ); ++target )
+		{
+			if( !renderTargets.count( *target ) )
+			{
+				continue;
+			}
+			
+			auto lifetime = lifetimes.find( *target );
+			
+			if( lifetime == lifetimes.end( ) )
+			{
+				lifetimes[ *target ] = U::p( p, p );
+			}
+			else
+			{
+				lifetime->second.second = p;
+			}
+		}
+	}
+	
+	// Give each target, in order of first use, a pooled texture of the right
+	// size and format that no other target needs from that point on.
+	Array< Pair< size_t, CGSRenderTargetHandle > > byFirstUse;
+	for( auto i = lifetimes.begin( ); i != lifetimes.end( ); ++i )
+	{
+		byFirstUse.push_back( U::p( i->second.first, i->first ) );
+	}
+	std::sort( byFirstUse.begin( ), byFirstUse.end( ) );
+	
+	for( auto i = renderTargetPool.begin( ); i != renderTargetPool.end( ); ++i )
+	{
+		i->used = false;
+		i->freeFrom = 0;
+	}
+	
+	for( auto i = byFirstUse.begin( ); i != byFirstUse.end( ); ++i )
+	{
+		const RenderTarget& target = renderTargets.find( i->second )->second;
+		uint16_t width = U::max( screenX / target.sizeDivisor, 1 );
+		uint16_t height = U::max( screenY / target.sizeDivisor, 1 );
+		GLenum format = target.internalFormat ? target.internalFormat : internalFormat;
+		
+		size_t k = 0;
+		for( ; k < renderTargetPool.size( ); ++k )
+		{
+			const PooledRenderTarget& pooled = renderTargetPool[ k ];
+			
+			if( pooled.width == width && pooled.height == height
+					&& pooled.internalFormat == format
+					&& ( !pooled.used || pooled.freeFrom <= i->first ) )
+			{
+				break;
+			}
+		}
+		
+		if( k == renderTargetPool.size( ) )
+		{
+			PooledRenderTarget pooled;
+			pooled.width = width;
+			pooled.height = height;
+			pooled.internalFormat = format;
+			uint64_t descriptor = _getTargetDescriptor( width, height, format );
+			
+			// Without an assignment, stages rendering to the target are skipped.
+			// _createTargetTexture( ) logs the failure, so it is only tried once.
+			if( failedRenderTargets.count( descriptor ) )
+			{
+				continue;
+			}
+			
+			if( !_createTargetTexture( width, height, format, pooled.texture, pooled.framebuffer ) )
+			{
+				failedRenderTargets.insert( descriptor );
+				continue;
+			}
+			
+			renderTargetPool.push_back( pooled );
+		}
+		
+		renderTargetPool[ k ].used = true;
+		renderTargetPool[ k ].freeFrom = lifetimes[ i->second ].second + 1;
+		renderTargetPool[ k ].unusedFrames = 0;
+		_assignments[ i->second ] = k;
+	}
+}
+
+bool GraphicsSystem::_createTargetTexture(
+		const uint16_t& _width,
+		const uint16_t& _height,
+		const GLenum& _internalFormat,
+		GLuint& _texture,
+		GLuint& _framebuffer )
+{
+	glGenTextures( 1, &_texture );
+	stateCache.bindTextureToActiveUnit( GL_TEXTURE_2D, _texture );
+	glTexStorage2D( GL_TEXTURE_2D, 1, _internalFormat, _width, _height );
+	
+	// Reduced resolution targets are magnified when upsampled to the screen,
+	// which should interpolate rather than show blocks.
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+	
+	glGenFramebuffers( 1, &_framebuffer );
+	stateCache.bindFramebuffer( GL_DRAW_FRAMEBUFFER, _framebuffer );
+	glFramebufferTexture2D(
+			GL_DRAW_FRAMEBUFFER,
+			GL_COLOR_ATTACHMENT0,
+			GL_TEXTURE_2D,
+			_texture,
+			0 );
+	
+	// The attachment never changes afterwards, so this is the only check.
+	if( glCheckFramebufferStatus( GL_DRAW_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+	{
+		U::log( "Error: A ", _width, "x", _height, " render target is not renderable with internal format ", _internalFormat );
+		
+		stateCache._notifyFramebufferDeleted( _framebuffer );
+		glDeleteFramebuffers( 1, &_framebuffer );
+		stateCache._notifyTextureDeleted( _texture );
+		glDeleteTextures( 1, &_texture );
+		_texture = 0;
+		_framebuffer = 0;
+		return false;
+	}
+	
+	return true;
+}
+
+GraphicsSystem::StageCache& GraphicsSystem::_getStageCache(
+		const uint8_t& _index,
+		const CGSRenderStage& _stage )
+{
+	uint16_t width = U::max( screenX / _stage.getResolutionDivisor( ), 1 );
+	uint16_t height = U::max( screenY / _stage.getResolutionDivisor( ), 1 );
+	auto i = stageCaches.find( _index );
+	
+	if( i != stageCaches.end( ) )
+	{
+		if( i->second.width == width && i->second.height == height
+				&& i->second.internalFormat == internalFormat )
+		{
+			return i->second;
+		}
+		
+		_deleteStageCache( _index );
+	}
+	
+	StageCache cache;
+	cache.width = width;
+	cache.height = height;
+	cache.internalFormat = internalFormat;
+	cache.signature = 0;
+	cache.valid = false;
+	
+	// This is the screen target's format, which is already known to be
+	// renderable.
+	_createTargetTexture( width, height, internalFormat, cache.texture, cache.framebuffer );
+	
+	return stageCaches.insert( U::p( _index, cache ) ).first->second;
+}
+
+void GraphicsSystem::_deleteStageCache( const uint8_t& _index )
 {
-	operations.insert( U::p( _position, CGSRenderOperation( _mesh, _pullBackbuffer ) ) );
+	auto i = stageCaches.find( _index );
+	
+	if( i == stageCaches.end( ) )
+	{
+		return;
+	}
+	
+	// The last frame may still be compositing the texture.
+	stateCache._notifyFramebufferDeleted( i->second.framebuffer );
+	glDeleteFramebuffers( 1, &i->second.framebuffer );
+	frameSync.deleteTextureWhenComplete( i->second.texture );
+	stageCaches.erase( i );
 }
 
+uint64_t GraphicsSystem::_getStageCacheSignature( CGSRenderStage& _stage ) const
+{
+	uint64_t signature = 14695981039346656037ULL;
+	_hashBytes( signature, &renderX, sizeof( renderX ) );
+	_hashBytes( signature, &renderY, sizeof( renderY ) );
+	
+	// The mesh ID, unlike its address, is never reused by another mesh.
+	const Array< CGSRenderCommand >& commands = _stage._getCommands( );
+	for( auto i = commands.begin( ); i != commands.end( ); ++i )
+	{
+		CGSMesh* mesh = i->operation.mesh;
+		uint32_t id = mesh->getID( );
+		uint32_t changes = mesh->_getChangeCount( );
+		GLenum renderOperation = mesh->_getRenderOperation( );
+		_hashBytes( signature, &i->key, sizeof( i->key ) );
+		_hashBytes( signature, &id, sizeof( id ) );
+		_hashBytes( signature, &changes, sizeof( changes ) );
+		_hashBytes( signature, &renderOperation, sizeof( renderOperation ) );
+		
+		if( _isProgramShared( mesh->_getProgramHandle( ) ) )
+		{
+			_hashBytes( signature, &sharedUniformChanges, sizeof( sharedUniformChanges ) );
+		}
+	}
+	
+	const Array< float >& instanceData = _stage._getSortedInstanceData( );
+	
+	if( !instanceData.empty( ) )
+	{
+		_hashBytes( signature, instanceData.data( ), instanceData.size( ) * sizeof( float ) );
+	}
+	
+	return signature;
+}
 
-CGSMesh* GraphicsSystem::createCompositorMesh( const String& fragmentShader )
+CGSRenderTargetHandle GraphicsSystem::_getStageTarget(
+		const uint8_t& _index,
+		const CGSRenderStage& _stage )
 {
-	U::log( "createCompositorMesh( ) not implemented." );
-	return NULL;
+	if( _stage.getOutput( ) != CGSRenderStage::SCREEN_TARGET
+			|| _stage.getResolutionDivisor( ) == 1
+			|| _isStageCached( _stage ) )
+	{
+		// The pool keeps the texture for a few frames, so a stage switching
+		// back soon does not recreate it.
+		_releaseStageTarget( _index );
+		return _stage.getOutput( );
+	}
+	
+	auto target = reducedStageTargets.find( _index );
+	
+	if( target == reducedStageTargets.end( ) )
+	{
+		target = reducedStageTargets.insert(
+				U::p( _index, createRenderTarget( _stage.getResolutionDivisor( ) ) ) ).first;
+	}
+	else
+	{
+		renderTargets[ target->second ].sizeDivisor = _stage.getResolutionDivisor( );
+	}
+	
+	return target->second;
 }
 
-CGSRenderStage* GraphicsSystem::getRenderStage( const uint8_t& index )
+void GraphicsSystem::_releaseStageTarget( const uint8_t& _index )
 {
-	return &renderStages[ index ];
+	auto target = reducedStageTargets.find( _index );
+	
+	if( target != reducedStageTargets.end( ) )
+	{
+		deleteRenderTarget( target->second );
+		reducedStageTargets.erase( target );
+	}
 }
 
-bool GraphicsSystem::removeRenderStage( const uint8_t& index )
+bool GraphicsSystem::_compositeStageTexture(
+		const GLuint& _texture,
+		const uint16_t& _width,
+		const uint16_t& _height,
+		const bool& _depthWrites )
 {
-	return renderStages.erase( index );
+	if( !upsampleProgramHandle )
+	{
+		CGSShader vertexShader( ShaderType::VERTEX );
+		CGSShader fragmentShader( ShaderType::FRAGMENT );
+		
+		// CGSShader will print an error on build failure.
+		if( !vertexShader.build( COMPOSITOR_VERTEX_SHADER_SOURCE )
+				|| !fragmentShader.build( UPSAMPLE_FRAGMENT_SHADER_SOURCE ) )
+		{
+			return false;
+		}
+		
+		GLuint program = glCreateProgram( );
+		glAttachShader( program, vertexShader._getShaderHandle( ) );
+		glAttachShader( program, fragmentShader._getShaderHandle( ) );
+		glLinkProgram( program );
+		glDetachShader( program, vertexShader._getShaderHandle( ) );
+		glDetachShader( program, fragmentShader._getShaderHandle( ) );
+		
+		GLint linked = GL_FALSE;
+		glGetProgramiv( program, GL_LINK_STATUS, &linked );
+		
+		if( !linked )
+		{
+			U::log( "Error: Failed to link the program upsampling reduced resolution stages." );
+			glDeleteProgram( program );
+			return false;
+		}
+		
+		glProgramUniform1i( program, glGetUniformLocation( program, "source" ), 0 );
+		upsampleResolutionScaleLocation = glGetUniformLocation( program, "cgsResolutionScale" );
+		upsampleProgramHandle = program;
+	}
+	
+	// Only the part of the target rendered to at the current scale is read.
+	CGSScreenRegion rendered = _scaleRegion( CGSScreenRegion( 0, 0, _width, _height ) );
+	glProgramUniform2f( upsampleProgramHandle,
+			upsampleResolutionScaleLocation,
+			(float)rendered.width / _width,
+			(float)rendered.height / _height );
+	
+	stateCache.bindFramebuffer( GL_DRAW_FRAMEBUFFER, framebufferHandle );
+	glViewport( 0, 0, renderX, renderY );
+	stateCache.useProgram( upsampleProgramHandle );
+	stateCache.bindVertexArray( emptyVAOHandle );
+	stateCache.bindTexture( 0, GL_TEXTURE_2D, _texture );
+	
+	// CGS leaves blending to the application, so its state is put back after.
+	// Stage color is taken to be premultiplied by alpha; see
+	// CGSRenderStage::setResolutionDivisor( ).
+	CGSStateCache::BlendState applicationBlend = stateCache._getBlendState( );
+	CGSStateCache::BlendState premultipliedBlend;
+	premultipliedBlend.enabled = true;
+	premultipliedBlend.destinationRGB = GL_ONE_MINUS_SRC_ALPHA;
+	premultipliedBlend.destinationAlpha = GL_ONE_MINUS_SRC_ALPHA;
+	stateCache._setBlendState( premultipliedBlend );
+	
+	// The triangle is on the near plane; its depth must not hide later stages.
+	if( _depthWrites )
+	{
+		glDepthMask( GL_FALSE );
+	}
+	
+	glDrawArrays( GL_TRIANGLES, 0, 3 );
+	
+	if( _depthWrites )
+	{
+		glDepthMask( GL_TRUE );
+	}
+	
+	stateCache._setBlendState( applicationBlend );
+	
+	return true;
 }
 
-void _copyToBackbuffer(
-		const uint8_t& unit,
-		const GLuint& framebufferHandle,
-		const GLuint& backbufferTextureHandle,
-		const uint16_t& screenX,
-		const uint16_t& screenY )
+void GraphicsSystem::_trimRenderTargetPool( )
 {
-	glActiveTexture( GL_TEXTURE0 + unit );
-	glBindTexture( GL_TEXTURE_2D, backbufferTextureHandle );
-	glBindFramebuffer( GL_READ_FRAMEBUFFER, framebufferHandle );
-	glCopyTexSubImage2D(
-			GL_TEXTURE_2D,
-			0, // level
-			0, 0, // offset
-			0, 0, // x, y
-			screenX, screenY );
-	glBindFramebuffer( GL_DRAW_FRAMEBUFFER, framebufferHandle );
+	for( auto i = renderTargetPool.begin( ); i != renderTargetPool.end( ); )
+	{
+		if( i->used || ++i->unusedFrames < RENDER_TARGET_POOL_KEEP_FRAMES )
+		{
+			++i;
+			continue;
+		}
+		
+		// The frame that last used the texture may still be rendering.
+		stateCache._notifyFramebufferDeleted( i->framebuffer );
+		glDeleteFramebuffers( 1, &i->framebuffer );
+		frameSync.deleteTextureWhenComplete( i->texture );
+		i = renderTargetPool.erase( i );
+	}
 }
 
-void GraphicsSystem::render( )
+bool GraphicsSystem::_findDamage( const Array< uint8_t >& _order )
 {
-	assert( inititalized );
+	if( _order != lastOrder )
+	{
+		lastOrder = _order;
+		addDamage( );
+	}
+	
+	// Every stage is compared, even once the whole screen is damaged, so each
+	// is up to date for the next frame.
+	bool partial = true;
+	
+	for( auto i = _order.begin( ); i != _order.end( ); ++i )
+	{
+		auto stage = renderStages.find( *i );
+		
+		if( stage == renderStages.end( ) )
+		{
+			continue;
+		}
+		
+		CGSScreenRegion stageDamage;
+		
+		if( stage->second._findCommandDamage( stageDamage ) )
+		{
+			addDamage( stageDamage );
+		}
+		
+		// What reaches the screen through render targets cannot be traced back
+		// to where it came from.
+		if( stage->second.getOutput( ) != CGSRenderStage::SCREEN_TARGET
+				|| stage->second.getResolutionDivisor( ) > 1
+				|| !stage->second.getInputs( ).empty( ) )
+		{
+			partial = false;
+		}
+	}
+	
+	if( !damaged )
+	{
+		return false;
+	}
+	
+	CGSScreenRegion region = partial ? damage : CGSScreenRegion( );
+	damaged = false;
+	damage = CGSScreenRegion( );
+	
+	// Pulls read the backbuffer as of this frame only within the damage; the
+	// rest is left from the last frame, after later stages drew over it. So
+	// the damage grows to cover what every pull overlapping it reads, until no
+	// more pulls do. Each stage also reads the backbuffer from its first
+	// operation on.
+	bool grown = region.isKnown( );
+	
+	while( grown )
+	{
+		grown = false;
+		
+		for( auto i = _order.begin( ); i != _order.end( ) && region.isKnown( ); ++i )
+		{
+			auto stage = renderStages.find( *i );
+			
+			if( stage == renderStages.end( ) )
+			{
+				continue;
+			}
+			
+			const Array< CGSRenderCommand >& commands = stage->second._getCommands( );
+			
+			for( size_t j = 0; j < commands.size( ); ++j )
+			{
+				if( j && !commands[ j ].operation.pullBackbuffer )
+				{
+					continue;
+				}
+				
+				CGSScreenRegion pullRegion = stage->second._findPullRegion( j );
+				
+				if( !pullRegion.isKnown( ) )
+				{
+					region = CGSScreenRegion( );
+					break;
+				}
+				
+				if( region.intersects( pullRegion ) && !region.contains( pullRegion ) )
+				{
+					region.merge( pullRegion );
+					grown = true;
+				}
+			}
+		}
+	}
+	
+	if( !region.isKnown( ) )
+	{
+		return true;
+	}
+	
+	// Damage entirely off screen changes nothing visible.
+	if( region.x >= screenX || region.y >= screenY )
+	{
+		return false;
+	}
 	
+	region.width = U::min( region.width, (uint16_t)( screenX - region.x ) );
+	region.height = U::min( region.height, (uint16_t)( screenY - region.y ) );
+	
+	// Not worth a scissor.
+	if( region.width == screenX && region.height == screenY )
+	{
+		return true;
+	}
+	
+	lastDamage = region;
+	return true;
+}
+
+void GraphicsSystem::_renderStages( const Array< uint8_t >& _order )
+{
 	// Perform CGS system updates, primarily to ensure the data uploaded to the
 	// video card is up to date, and all linkages between objects are accurate.
 	
+	// Only objects changed since the last frame are queued; updating never
+	// queues anything again, so the queues are stable while iterated.
+	//
 	// Update of meshes must come first, in case uniforms need set from textures.
-	for( AssocArray< uint32_t, CGSMesh* >::iterator i = meshes.begin( );
-		i != meshes.end( ); ++i )
+	for( auto i = meshUpdateQueue.begin( ); i != meshUpdateQueue.end( ); ++i )
 	{
-		i->second->_update( );
+		(*i)->_update( );
 	}
 	
-	for( auto i = textures.begin( ); i != textures.end( ); ++i )
+	meshUpdateQueue.clear( );
+	
+	for( auto i = textureUpdateQueue.begin( ); i != textureUpdateQueue.end( ); ++i )
 	{
 		(*i)->_update( );
 	}
 	
-	// Prepare the render target framebuffer
-	glBindFramebuffer( GL_DRAW_FRAMEBUFFER, framebufferHandle );
-	glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+	textureUpdateQueue.clear( );
+	
+	// Sort every stage to be rendered, then upload the instance data of all of
+	// them at once. Each stage's data is placed after the previous stage's. A
+	// stage rendered more than once only needs its data once.
+	AssocArray< uint8_t, size_t > instanceDataBases;
+	size_t instanceDataTotal = 0;
+	for( auto i = _order.begin( ); i != _order.end( ); ++i )
+	{
+		auto stage = renderStages.find( *i );
+		
+		if( stage == renderStages.end( ) || instanceDataBases.count( *i ) )
+		{
+			continue;
+		}
+		
+		stage->second._sortCommands( );
+		instanceDataBases[ *i ] = instanceDataTotal;
+		instanceDataTotal += stage->second._getSortedInstanceData( ).size( );
+	}
+	
+	frameSkipped = false;
+	lastDamage = CGSScreenRegion( );
+	
+	if( damageTracking && !_findDamage( _order ) )
+	{
+		// The last frame is still on screen, and still right.
+		for( auto i = renderStages.begin( ); i != renderStages.end( ); ++i )
+		{
+			i->second._endFrame( );
+		}
+		
+		frameSkipped = true;
+		stateCache._endFrame( );
+		return;
+	}
+	
+	// The GPU is done with the buffer of this slot, so it is written in place
+	// rather than orphaned, and only reallocated to grow.
+	uint8_t frameSlot = frameSync.getFrameSlot( );
+	instanceBufferHandle = instanceBufferHandles[ frameSlot ];
+	
+	if( instanceDataTotal )
+	{
+		glBindBuffer( GL_ARRAY_BUFFER, instanceBufferHandle );
+		
+		if( instanceDataTotal > instanceBufferCapacities[ frameSlot ] )
+		{
+			instanceBufferCapacities[ frameSlot ] = instanceDataTotal * 2;
+			glBufferData( GL_ARRAY_BUFFER,
+					instanceBufferCapacities[ frameSlot ] * sizeof( float ),
+					NULL,
+					GL_DYNAMIC_DRAW );
+		}
+		
+		for( auto i = instanceDataBases.begin( ); i != instanceDataBases.end( ); ++i )
+		{
+			const Array< float >& stageInstanceData
+					= renderStages.find( i->first )->second._getSortedInstanceData( );
+			
+			if( !stageInstanceData.empty( ) )
+			{
+				glBufferSubData( GL_ARRAY_BUFFER,
+						i->second * sizeof( float ),
+						stageInstanceData.size( ) * sizeof( float ),
+						stageInstanceData.data( ) );
+			}
+		}
+		
+		glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	}
+	
+	AssocArray< CGSRenderTargetHandle, size_t > targetAssignments;
+	_allocateRenderTargets( _order, targetAssignments );
+	
+	// Relinking a program resets its uniforms, so compositor meshes are given
+	// the scale every frame. Programs without the uniform ignore location -1.
+	for( auto i = compositorMeshes.begin( ); i != compositorMeshes.end( ); ++i )
+	{
+		GLuint program = i->first->_getProgramHandle( true );
+		CompositorUniforms& uniforms = i->second;
+		
+		if( uniforms.program != program || uniforms.linkCount != i->first->_getLinkCount( ) )
+		{
+			uniforms.program = program;
+			uniforms.linkCount = i->first->_getLinkCount( );
+			uniforms.resolutionScaleLocation = glGetUniformLocation( program, "cgsResolutionScale" );
+		}
+		
+		glProgramUniform2f( program,
+				uniforms.resolutionScaleLocation,
+				(float)renderX / screenX,
+				(float)renderY / screenY );
+	}
+	
+	glBeginQuery( GL_TIME_ELAPSED, gpuTimeQueries[ frameSlot ] );
+	
+	// Prepare the render target framebuffer. Outside the damage, it still holds
+	// the last frame, so only the damage is cleared and redrawn.
+	bool scissored = lastDamage.isKnown( );
+	
+	if( scissored )
+	{
+		CGSScreenRegion scissor = _scaleRegion( lastDamage );
+		glEnable( GL_SCISSOR_TEST );
+		glScissor( scissor.x, scissor.y, scissor.width, scissor.height );
+	}
+	
+	stateCache.bindFramebuffer( GL_DRAW_FRAMEBUFFER, framebufferHandle );
+	glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT );
+	
+	// Only TRANSLUCENT operations leave depth untouched. The mask is back on
+	// by the end of the frame, so the clear above always reaches depth.
+	bool depthWrites = true;
+	
+	// Transient targets are cleared before the first stage writes to them.
+	UnorderedSet< CGSRenderTargetHandle > writtenTargets;
 	
 	// Now, perform the actual render operations.
-	for( auto i = renderStages.begin( ); i != renderStages.end( ); ++i )
+	for( auto i = _order.begin( ); i != _order.end( ); ++i )
 	{
-		// On the initial stage, this will also clear the backbuffer.
-		_copyToBackbuffer(
-				i->second._getBackbufferTextureUnit( ),
-				framebufferHandle,
-				backbufferTextureHandle,
-				screenX, screenY );
+		auto stageIterator = renderStages.find( *i );
+		
+		if( stageIterator == renderStages.end( ) )
+		{
+			U::log( "Warning: Render stage ", (uint32_t)*i, " does not exist and was not rendered." );
+			continue;
+		}
+		
+		CGSRenderStage& stage = stageIterator->second;
+		CGSRenderTargetHandle output = stage.getOutput( );
+		CGSRenderTargetHandle target = _getStageTarget( *i, stage );
+		bool cached = _isStageCached( stage );
+		bool toScreen = ( target == CGSRenderStage::SCREEN_TARGET ) && !cached;
+		bool reduced = ( target != output );
+		
+		// Reduced and cached stages render to a texture drawn over the screen
+		// after them.
+		GLuint compositeTexture = 0;
+		uint16_t compositeWidth = 0;
+		uint16_t compositeHeight = 0;
+		bool unscissored = false;
+		
+		if( !cached && stageCaches.count( *i ) )
+		{
+			_deleteStageCache( *i );
+		}
+		
+		if( cached )
+		{
+			StageCache& cache = _getStageCache( *i, stage );
+			uint64_t signature = _getStageCacheSignature( stage );
+			compositeTexture = cache.texture;
+			compositeWidth = cache.width;
+			compositeHeight = cache.height;
+			
+			if( cache.valid && cache.signature == signature )
+			{
+				_compositeStageTexture( compositeTexture, compositeWidth, compositeHeight, depthWrites );
+				continue;
+			}
+			
+			// Outside the damage, a valid cache still holds what is right. A new
+			// one holds nothing, so it is rendered whole.
+			if( !cache.valid && scissored )
+			{
+				glDisable( GL_SCISSOR_TEST );
+				unscissored = true;
+			}
+			
+			cache.signature = signature;
+			cache.valid = true;
+			
+			CGSScreenRegion rendered = _scaleRegion( CGSScreenRegion( 0, 0, cache.width, cache.height ) );
+			stateCache.bindFramebuffer( GL_DRAW_FRAMEBUFFER, cache.framebuffer );
+			glViewport( 0, 0, rendered.width, rendered.height );
+			glClear( GL_COLOR_BUFFER_BIT );
+		}
+		else if( toScreen )
+		{
+			stateCache.bindFramebuffer( GL_DRAW_FRAMEBUFFER, framebufferHandle );
+			glViewport( 0, 0, renderX, renderY );
+		}
+		else
+		{
+			auto assignment = targetAssignments.find( target );
+			
+			// The target was deleted.
+			if( assignment == targetAssignments.end( ) )
+			{
+				continue;
+			}
+			
+			const PooledRenderTarget& pooled = renderTargetPool[ assignment->second ];
+			CGSScreenRegion rendered = _scaleRegion( CGSScreenRegion( 0, 0, pooled.width, pooled.height ) );
+			stateCache.bindFramebuffer( GL_DRAW_FRAMEBUFFER, pooled.framebuffer );
+			glViewport( 0, 0, rendered.width, rendered.height );
+			
+			// A reduced stage is composited each time it renders, so it starts
+			// from nothing each time too.
+			if( writtenTargets.insert( target ).second || reduced )
+			{
+				glClear( GL_COLOR_BUFFER_BIT );
+			}
+			
+			if( reduced )
+			{
+				compositeTexture = pooled.texture;
+				compositeWidth = pooled.width;
+				compositeHeight = pooled.height;
+			}
+		}
+		
+		// The backbuffer is a copy of the screen target, so stages rendering
+		// elsewhere do not pull; they use inputs instead. Neither do stages with
+		// an input on their backbuffer unit, as the pull would replace it.
+		bool pullsBackbuffer = toScreen;
+		
+		// Bind the targets this stage reads. A stage cannot read its own output.
+		const Array< Pair< CGSRenderTargetHandle, uint8_t > >& inputs = stage.getInputs( );
+		for( auto input = inputs.begin( ); input != inputs.end( ); ++input )
+		{
+			if( input->first == output )
+			{
+				continue;
+			}
+			
+			if( input->second == stage._getBackbufferTextureUnit( ) )
+			{
+				pullsBackbuffer = false;
+			}
+			
+			GLuint texture = 0;
+			
+			if( input->first == CGSRenderStage::SCREEN_TARGET )
+			{
+				texture = framebufferInternalTextureHandle;
+			}
+			else
+			{
+				auto assignment = targetAssignments.find( input->first );
+				
+				if( assignment != targetAssignments.end( ) )
+				{
+					texture = renderTargetPool[ assignment->second ].texture;
+				}
+			}
+			
+			stateCache.bindTexture( input->second, GL_TEXTURE_2D, texture );
+		}
+		
+		// A query over only the damage would hide meshes outside it next frame,
+		// and a cache would keep a hidden mesh hidden for as long as it is used.
+		bool testsOcclusion = ( !scissored || unscissored ) && !cached;
 		
-		AssocArrayMulti< CGSRenderOrderingType, CGSRenderOperation >& operations
-				= i->second._getOperations( );
-		for( auto j = operations.begin( ); j != operations.end( ); ++j )
+		// Runs of the same mesh are drawn as a single instanced draw, and runs of
+		// compatible meshes as a single multi-draw if enabled. A pull can only
+		// start a run or multi-draw, never be inside one.
+		Array< CGSRenderCommand >& commands = stage._getCommands( );
+		size_t instanceDataBase = instanceDataBases[ *i ];
+		
+		// On the initial stage, this will also clear the backbuffer. It is not
+		// needed if the stage is empty or starts with a pull of its own.
+		if( pullsBackbuffer && !commands.empty( ) && !commands.front( ).operation.pullBackbuffer )
+		{
+			_pullBackbuffer( stage._getBackbufferTextureUnit( ), stage._findPullRegion( 0 ) );
+		}
+		
+		for( size_t j = 0; j < commands.size( ); )
 		{
-			if( j->second.pullBackbuffer )
+			const CGSRenderOperation& operation = commands[ j ].operation;
+			
+			if( pullsBackbuffer && operation.pullBackbuffer )
+			{
+				_pullBackbuffer( stage._getBackbufferTextureUnit( ), stage._findPullRegion( j ) );
+			}
+			
+			if( depthWrites != ( operation.renderClass != CGSRenderClass::TRANSLUCENT ) )
 			{
-				_copyToBackbuffer(
-						i->second._getBackbufferTextureUnit( ),
-						framebufferHandle,
-						backbufferTextureHandle,
-						screenX, screenY );
+				depthWrites = !depthWrites;
+				glDepthMask( depthWrites ? GL_TRUE : GL_FALSE );
 			}
 			
-			j->second.mesh->_render( );
+			size_t runEnd = stage._findInstanceRunEnd( j );
+			size_t drawEnd = runEnd;
+			
+			if( multiDrawIndirect )
+			{
+				drawEnd = _findMultiDrawEnd( stage, j, runEnd );
+			}
+			
+			if( drawEnd != runEnd )
+			{
+				_renderMultiDraw( stage, j, drawEnd, instanceDataBase );
+			}
+			else if( operation.mesh->getOcclusionProxy( ) && testsOcclusion )
+			{
+				_renderOcclusionTested(
+						operation.mesh,
+						runEnd - j,
+						( instanceDataBase + operation.instanceDataOffset ) * sizeof( float ),
+						depthWrites );
+			}
+			else
+			{
+				operation.mesh->_render(
+						runEnd - j,
+						instanceBufferHandle,
+						( instanceDataBase + operation.instanceDataOffset ) * sizeof( float ) );
+			}
+			
+			j = drawEnd;
+		}
+		
+		if( unscissored )
+		{
+			glEnable( GL_SCISSOR_TEST );
+		}
+		
+		if( compositeTexture )
+		{
+			_compositeStageTexture( compositeTexture, compositeWidth, compositeHeight, depthWrites );
 		}
-		operations.clear( );
 	}
 	
-	// Copy render target to the default framebuffer
-	glBindFramebuffer( GL_DRAW_FRAMEBUFFER, 0 ); // Default framebuffer
-	glBindFramebuffer( GL_READ_FRAMEBUFFER, framebufferHandle );
+	glViewport( 0, 0, screenX, screenY );
+	glEndQuery( GL_TIME_ELAPSED );
+	gpuTimeQueriesPending[ frameSlot ] = true;
+	
+	// The blit would be scissored too.
+	if( scissored )
+	{
+		glDisable( GL_SCISSOR_TEST );
+	}
+	
+	if( !depthWrites )
+	{
+		glDepthMask( GL_TRUE );
+	}
+	
+	// Every stage ends its frame, including stages that were not rendered, so
+	// immediate operations never carry over.
+	for( auto i = renderStages.begin( ); i != renderStages.end( ); ++i )
+	{
+		i->second._endFrame( );
+	}
+	
+	_trimRenderTargetPool( );
+	
+	// Copy render target to the default framebuffer. Depth is not needed there,
+	// and blitting it would fail if the window's depth format differs. Below
+	// full resolution, the part rendered to is upscaled.
+	stateCache.bindFramebuffer( GL_DRAW_FRAMEBUFFER, 0 ); // Default framebuffer
+	stateCache.bindFramebuffer( GL_READ_FRAMEBUFFER, framebufferHandle );
 	glBlitFramebuffer(
+			0, 0, renderX, renderY,
 			0, 0, screenX, screenY,
-			0, 0, screenX, screenY,
-			GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT,
-			GL_NEAREST );
+			GL_COLOR_BUFFER_BIT,
+			( renderX == screenX && renderY == screenY ) ? GL_NEAREST : GL_LINEAR );
 	
 	// Render the default framebuffer to the screen
 	SDL_GL_SwapWindow( sdlWindow );
+	
+	glQueryCounter( latencyQueries[ frameSlot ], GL_TIMESTAMP );
+	latencyFrameStarts[ frameSlot ] = frameStartTime;
+	latencyQueriesPending[ frameSlot ] = true;
+	
+	frameSync._endFrame( );
+	stateCache._endFrame( );
 }
@@ -0,0 +1,295 @@
+/*	Copyright (c) 2015-2016 William Kappler
+
+	Permission to use, copy, modify, and/or distribute this software for any
+	purpose with or without fee is hereby granted, provided that the above
+	copyright notice and this permission notice appear in all copies.
+
+	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+	REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+	AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+	INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+	LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+	OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+	PERFORMANCE OF THIS SOFTWARE. */
+
+#include "CGSStateCache.h"
+
+// Values are given in the header so they can size arrays; these are the
+// definitions required if they are ever bound to a reference.
+const uint8_t CGSStateCache::MAX_TRACKED_TEXTURE_UNITS;
+const GLuint CGSStateCache::UNKNOWN_BINDING;
+const uint8_t CGSStateCache::UNKNOWN_UNIT;
+
+CGSStateCache::BlendState::BlendState( )
+{
+	enabled = false;
+	sourceRGB = GL_ONE;
+	destinationRGB = GL_ZERO;
+	sourceAlpha = GL_ONE;
+	destinationAlpha = GL_ZERO;
+	equationRGB = GL_FUNC_ADD;
+	equationAlpha = GL_FUNC_ADD;
+}
+
+bool CGSStateCache::BlendState::operator==( const BlendState& _other ) const
+{
+	return enabled == _other.enabled
+			&& sourceRGB == _other.sourceRGB
+			&& destinationRGB == _other.destinationRGB
+			&& sourceAlpha == _other.sourceAlpha
+			&& destinationAlpha == _other.destinationAlpha
+			&& equationRGB == _other.equationRGB
+			&& equationAlpha == _other.equationAlpha;
+}
+
+CGSStateCache::CGSStateCache( )
+{
+	callsIssued = 0;
+	callsSkipped = 0;
+	lastFrameCallsIssued = 0;
+	lastFrameCallsSkipped = 0;
+
+	invalidate( );
+}
+
+void CGSStateCache::useProgram( const GLuint& _program )
+{
+	if( program == _program )
+	{
+		++callsSkipped;
+		return;
+	}
+
+	glUseProgram( _program );
+	program = _program;
+	++callsIssued;
+}
+
+void CGSStateCache::bindVertexArray( const GLuint& _vao )
+{
+	if( vertexArray == _vao )
+	{
+		++callsSkipped;
+		return;
+	}
+
+	glBindVertexArray( _vao );
+	vertexArray = _vao;
+	++callsIssued;
+}
+
+void CGSStateCache::bindFramebuffer( const GLenum& _target, const GLuint& _framebuffer )
+{
+	bool draw = ( _target == GL_FRAMEBUFFER || _target == GL_DRAW_FRAMEBUFFER );
+	bool read = ( _target == GL_FRAMEBUFFER || _target == GL_READ_FRAMEBUFFER );
+
+	if( ( !draw || drawFramebuffer == _framebuffer )
+			&& ( !read || readFramebuffer == _framebuffer ) )
+	{
+		++callsSkipped;
+		return;
+	}
+
+	glBindFramebuffer( _target, _framebuffer );
+	++callsIssued;
+
+	if( draw )
+	{
+		drawFramebuffer = _framebuffer;
+	}
+
+	if( read )
+	{
+		readFramebuffer = _framebuffer;
+	}
+}
+
+void CGSStateCache::activeTexture( const uint8_t& _unit )
+{
+	if( activeUnit == _unit )
+	{
+		++callsSkipped;
+		return;
+	}
+
+	glActiveTexture( GL_TEXTURE0 + _unit );
+	activeUnit = _unit;
+	++callsIssued;
+}
+
+void CGSStateCache::bindTexture( const uint8_t& _unit, const GLenum& _target, const GLuint& _texture )
+{
+	if( _unit < MAX_TRACKED_TEXTURE_UNITS
+			&& textureUnits[ _unit ].target == _target
+			&& textureUnits[ _unit ].texture == _texture )
+	{
+		++callsSkipped;
+		return;
+	}
+
+	activeTexture( _unit );
+	bindTextureToActiveUnit( _target, _texture );
+}
+
+void CGSStateCache::bindTextureToActiveUnit( const GLenum& _target, const GLuint& _texture )
+{
+	if( activeUnit == UNKNOWN_UNIT )
+	{
+		activeTexture( 0 );
+	}
+
+	glBindTexture( _target, _texture );
+	++callsIssued;
+
+	// Only one target per unit is remembered. Binding a different target to a
+	// unit forgets the previous one, which is conservative: it can only cause
+	// a later bind to be issued when it could have been skipped.
+	if( activeUnit < MAX_TRACKED_TEXTURE_UNITS )
+	{
+		textureUnits[ activeUnit ].target = _target;
+		textureUnits[ activeUnit ].texture = _texture;
+	}
+}
+
+const CGSStateCache::BlendState& CGSStateCache::_getBlendState( )
+{
+	if( blendStateKnown )
+	{
+		return blendState;
+	}
+
+	GLint value;
+	blendState.enabled = ( glIsEnabled( GL_BLEND ) == GL_TRUE );
+	glGetIntegerv( GL_BLEND_SRC_RGB, &value );
+	blendState.sourceRGB = value;
+	glGetIntegerv( GL_BLEND_DST_RGB, &value );
+	blendState.destinationRGB = value;
+	glGetIntegerv( GL_BLEND_SRC_ALPHA, &value );
+	blendState.sourceAlpha = value;
+	glGetIntegerv( GL_BLEND_DST_ALPHA, &value );
+	blendState.destinationAlpha = value;
+	glGetIntegerv( GL_BLEND_EQUATION_RGB, &value );
+	blendState.equationRGB = value;
+	glGetIntegerv( GL_BLEND_EQUATION_ALPHA, &value );
+	blendState.equationAlpha = value;
+
+	blendStateKnown = true;
+	return blendState;
+}
+
+void CGSStateCache::_setBlendState( const BlendState& _state )
+{
+	if( blendStateKnown && blendState == _state )
+	{
+		++callsSkipped;
+		return;
+	}
+
+	if( !blendStateKnown || blendState.enabled != _state.enabled )
+	{
+		if( _state.enabled )
+		{
+			glEnable( GL_BLEND );
+		}
+		else
+		{
+			glDisable( GL_BLEND );
+		}
+
+		++callsIssued;
+	}
+
+	if( !blendStateKnown
+			|| blendState.sourceRGB != _state.sourceRGB
+			|| blendState.destinationRGB != _state.destinationRGB
+			|| blendState.sourceAlpha != _state.sourceAlpha
+			|| blendState.destinationAlpha != _state.destinationAlpha )
+	{
+		glBlendFuncSeparate(
+				_state.sourceRGB,
+				_state.destinationRGB,
+				_state.sourceAlpha,
+				_state.destinationAlpha );
+		++callsIssued;
+	}
+
+	if( !blendStateKnown
+			|| blendState.equationRGB != _state.equationRGB
+			|| blendState.equationAlpha != _state.equationAlpha )
+	{
+		glBlendEquationSeparate( _state.equationRGB, _state.equationAlpha );
+		++callsIssued;
+	}
+
+	blendState = _state;
+	blendStateKnown = true;
+}
+
+void CGSStateCache::invalidate( )
+{
+	program = UNKNOWN_BINDING;
+	vertexArray = UNKNOWN_BINDING;
+	drawFramebuffer = UNKNOWN_BINDING;
+	readFramebuffer = UNKNOWN_BINDING;
+	activeUnit = UNKNOWN_UNIT;
+	blendStateKnown = false;
+
+	for( uint8_t i = 0; i < MAX_TRACKED_TEXTURE_UNITS; ++i )
+	{
+		textureUnits[ i ].target = GL_NONE;
+		textureUnits[ i ].texture = UNKNOWN_BINDING;
+	}
+}
+
+void CGSStateCache::_endFrame( )
+{
+	lastFrameCallsIssued = callsIssued;
+	lastFrameCallsSkipped = callsSkipped;
+	callsIssued = 0;
+	callsSkipped = 0;
+	blendStateKnown = false;
+}
+
+void CGSStateCache::_notifyProgramDeleted( const GLuint& _program )
+{
+	// A program in use is only flagged for deletion, so whether it is still
+	// bound is up to the driver. Just stop assuming anything.
+	if( program == _program )
+	{
+		program = UNKNOWN_BINDING;
+	}
+}
+
+void CGSStateCache::_notifyVertexArrayDeleted( const GLuint& _vao )
+{
+	// Deleting the bound VAO reverts the binding to zero.
+	if( vertexArray == _vao )
+	{
+		vertexArray = 0;
+	}
+}
+
+void CGSStateCache::_notifyFramebufferDeleted( const GLuint& _framebuffer )
+{
+	if( drawFramebuffer == _framebuffer )
+	{
+		drawFramebuffer = 0;
+	}
+
+	if( readFramebuffer == _framebuffer )
+	{
+		readFramebuffer = 0;
+	}
+}
+
+void CGSStateCache::_notifyTextureDeleted( const GLuint& _texture )
+{
+	// Deleting a texture unbinds it from every unit it was bound to.
+	for( uint8_t i = 0; i < MAX_TRACKED_TEXTURE_UNITS; ++i )
+	{
+		if( textureUnits[ i ].texture == _texture )
+		{
+			textureUnits[ i ].texture = 0;
+		}
+	}
+}
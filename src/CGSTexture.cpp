@@ -264,6 +264,9 @@ CGSTexture::CGSTexture( )
 	deleteWhenUnused = false;
 	modified = true;
 	storageModified = true;
+	
+	// The GraphicsSystem queues new textures itself.
+	queuedForUpdate = true;
 
 	allowOverAllocation = false;
 	pixelFormat = TextureFormat::INVALID;
@@ -290,7 +293,14 @@ CGSTexture::~CGSTexture( )
 	}
 
 	if( textureHandle )
+	{
+		if( GraphicsSystem::getGlobalInstance( ) )
+		{
+			GraphicsSystem::getGlobalInstance( )->_getStateCache( )._notifyTextureDeleted( textureHandle );
+		}
+		
 		glDeleteTextures( 1, &textureHandle );
+	}
 
 	if( textureStartAddress )
 		delete[] textureStartAddress;
@@ -472,6 +482,7 @@ void CGSTexture::_swapTextureData(
 
 	if( textureHandle )
 	{
+		GraphicsSystem::getGlobalInstance( )->_getStateCache( )._notifyTextureDeleted( textureHandle );
 		glDeleteTextures( 1, &textureHandle );
 	}
 
@@ -498,7 +509,7 @@ void CGSTexture::_swapTextureData(
 	useModifiedChannelOrdering = GraphicsSystem::_useModifiedChannelOrdering( _format );
 
 	// Trigger upload and uniform updates
-	modified = true;
+	setModified( );
 }
 
 void CGSTexture::_constructTextureLookupTable( )
@@ -572,8 +583,8 @@ void CGSTexture::_detachFromMesh( CGSMeshToTextureAdapter * const& _connector )
 
 void CGSTexture::_bind( const uint8_t& _unit )
 {
-	glActiveTexture( GL_TEXTURE0 + _unit );
-	glBindTexture( ( GLenum )dimensionality, textureHandle );
+	GraphicsSystem::getGlobalInstance( )->_getStateCache( ).bindTexture(
+			_unit, ( GLenum )dimensionality, textureHandle );
 }
 
 vec3 CGSTexture::_generateTextureUsedRange( )
@@ -626,6 +637,18 @@ void CGSTexture::_setProgramUniforms(
 	glProgramUniform3fv( _connector->getProgramHandle( ), uniformLocation, 1, range.d );
 }
 
+void CGSTexture::_queueUpdate( )
+{
+	// New contents change how every mesh using the texture looks.
+	for( auto i = meshAdapters.begin( ); i != meshAdapters.end( ); ++i )
+	{
+		(*i)->getMesh( )->markDamaged( );
+	}
+	
+	queuedForUpdate = true;
+	GraphicsSystem::getGlobalInstance( )->_queueTextureUpdate( this );
+}
+
 void CGSTexture::_updateAllAdapterUniforms( const vec3& range )
 {
 	for( auto i = meshAdapters.begin( ); i != meshAdapters.end( ); ++i )
@@ -863,9 +886,9 @@ CGSTextureHole CGSTexture::hole(
 		const uint8_t& _channel )
 {
 	#ifndef DISABLE_TEXTURE_HOLE_SIZE_CHECKS
-	return CGSTextureHole( address3D( _x, _y, _z, _channel ), channelSize, &modified );
+	return CGSTextureHole( address3D( _x, _y, _z, _channel ), channelSize, this );
 	#else
-	return CGSTextureHole( address3D( _x, _y, _z, _channel ), &modified );
+	return CGSTextureHole( address3D( _x, _y, _z, _channel ), this );
 	#endif
 }
 
@@ -943,6 +966,8 @@ CGSTexture1D::CGSTexture1D(
 
 void CGSTexture1D::_update( )
 {
+	queuedForUpdate = false;
+	
 	if( !modified || !textureStartAddress )
 	{
 		return;
@@ -964,7 +989,8 @@ void CGSTexture1D::_update( )
 		glInvalidateTexImage( textureHandle, 0 );
 	}
 
-	glBindTexture( ( GLenum )dimensionality, textureHandle );
+	GraphicsSystem::getGlobalInstance( )->_getStateCache( ).bindTextureToActiveUnit(
+			( GLenum )dimensionality, textureHandle );
 	
 	if( storageModified )
 	{
@@ -1043,9 +1069,9 @@ CGSTextureHole CGSTexture1D::hole(
 		U::log( " - Number of X texels: ", xTexels );
 
 		#ifndef DISABLE_TEXTURE_HOLE_SIZE_CHECKS
-		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, channelSize, &modified );
+		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, channelSize, this );
 		#else
-		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, &modified );
+		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, this );
 		#endif
 	}
 	if( _y != 0 )
@@ -1062,9 +1088,9 @@ CGSTextureHole CGSTexture1D::hole(
 		U::log( " - Channel ID: ", (int)_channel );
 		
 		#ifndef DISABLE_TEXTURE_HOLE_SIZE_CHECKS
-		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, channelSize, &modified );
+		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, channelSize, this );
 		#else
-		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, &modified );
+		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, this );
 		#endif
 	}
 	if( _channel >= channelsPerTexel && _channel != 4 )
@@ -1076,9 +1102,9 @@ CGSTextureHole CGSTexture1D::hole(
 	#endif
 
 	#ifndef DISABLE_TEXTURE_HOLE_SIZE_CHECKS
-	return CGSTextureHole( address1D( _x, _channel ), channelSize, &modified );
+	return CGSTextureHole( address1D( _x, _channel ), channelSize, this );
 	#else
-	return CGSTextureHole( address1D( _x, _channel ), &modified );
+	return CGSTextureHole( address1D( _x, _channel ), this );
 	#endif
 }
 
@@ -1164,6 +1190,8 @@ CGSTexture2D::CGSTexture2D(
 
 void CGSTexture2D::_update( )
 {
+	queuedForUpdate = false;
+	
 	if( !modified || !textureStartAddress )
 	{
 		return;
@@ -1185,7 +1213,8 @@ void CGSTexture2D::_update( )
 		glInvalidateTexImage( textureHandle, 0 );
 	}
 
-	glBindTexture( ( GLenum )dimensionality, textureHandle );
+	GraphicsSystem::getGlobalInstance( )->_getStateCache( ).bindTextureToActiveUnit(
+			( GLenum )dimensionality, textureHandle );
 	
 	if( storageModified )
 	{
@@ -1268,9 +1297,9 @@ CGSTextureHole CGSTexture2D::hole(
 		U::log( " - Number of X texels: ", xTexels );
 
 		#ifndef DISABLE_TEXTURE_HOLE_SIZE_CHECKS
-		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, channelSize, &modified );
+		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, channelSize, this );
 		#else
-		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, &modified );
+		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, this );
 		#endif
 	}
 	if( _y >= yTexels )
@@ -1280,9 +1309,9 @@ CGSTextureHole CGSTexture2D::hole(
 		U::log( " - Number of Y texels: ", yTexels );
 
 		#ifndef DISABLE_TEXTURE_HOLE_SIZE_CHECKS
-		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, channelSize, &modified );
+		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, channelSize, this );
 		#else
-		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, &modified );
+		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, this );
 		#endif
 	}
 	if( _z != 0 )
@@ -1295,9 +1324,9 @@ CGSTextureHole CGSTexture2D::hole(
 		U::log( " - Channel ID: ", (int)_channel );
 		
 		#ifndef DISABLE_TEXTURE_HOLE_SIZE_CHECKS
-		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, channelSize, &modified );
+		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, channelSize, this );
 		#else
-		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, &modified );
+		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, this );
 		#endif
 	}
 	if( _channel >= channelsPerTexel && _channel != 4 )
@@ -1309,9 +1338,9 @@ CGSTextureHole CGSTexture2D::hole(
 	#endif
 
 	#ifndef DISABLE_TEXTURE_HOLE_SIZE_CHECKS
-	return CGSTextureHole( address2D( _x, _y, _channel ), channelSize, &modified );
+	return CGSTextureHole( address2D( _x, _y, _channel ), channelSize, this );
 	#else
-	return CGSTextureHole( address2D( _x, _y, _channel ), &modified );
+	return CGSTextureHole( address2D( _x, _y, _channel ), this );
 	#endif
 }
 
@@ -1399,6 +1428,8 @@ CGSTexture3D::CGSTexture3D(
 
 void CGSTexture3D::_update( )
 {
+	queuedForUpdate = false;
+	
 	if( !modified || !textureStartAddress )
 	{
 		return;
@@ -1420,7 +1451,8 @@ void CGSTexture3D::_update( )
 		glInvalidateTexImage( textureHandle, 0 );
 	}
 
-	glBindTexture( ( GLenum )dimensionality, textureHandle );
+	GraphicsSystem::getGlobalInstance( )->_getStateCache( ).bindTextureToActiveUnit(
+			( GLenum )dimensionality, textureHandle );
 	
 	if( storageModified )
 	{
@@ -1507,9 +1539,9 @@ CGSTextureHole CGSTexture3D::hole(
 		U::log( " - Number of X texels: ", xTexels );
 
 		#ifndef DISABLE_TEXTURE_HOLE_SIZE_CHECKS
-		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, channelSize, &modified );
+		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, channelSize, this );
 		#else
-		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, &modified );
+		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, this );
 		#endif
 	}
 	if( _y >= yTexels )
@@ -1519,9 +1551,9 @@ CGSTextureHole CGSTexture3D::hole(
 		U::log( " - Number of Y texels: ", yTexels );
 
 		#ifndef DISABLE_TEXTURE_HOLE_SIZE_CHECKS
-		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, channelSize, &modified );
+		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, channelSize, this );
 		#else
-		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, &modified );
+		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, this );
 		#endif
 	}
 	if( _z >= zTexels )
@@ -1531,9 +1563,9 @@ CGSTextureHole CGSTexture3D::hole(
 		U::log( " - Number of Z texels: ", zTexels );
 
 		#ifndef DISABLE_TEXTURE_HOLE_SIZE_CHECKS
-		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, channelSize, &modified );
+		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, channelSize, this );
 		#else
-		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, &modified );
+		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, this );
 		#endif
 	}
 	if( _channel >= 5 )
@@ -1542,9 +1574,9 @@ CGSTextureHole CGSTexture3D::hole(
 		U::log( " - Channel ID: ", (int)_channel );
 		
 		#ifndef DISABLE_TEXTURE_HOLE_SIZE_CHECKS
-		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, channelSize, &modified );
+		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, channelSize, this );
 		#else
-		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, &modified );
+		return CGSTextureHole( (uint8_t*)&invalidTextureHoleLocation, this );
 		#endif
 	}
 	if( _channel >= channelsPerTexel && _channel != 4 )
@@ -1556,9 +1588,9 @@ CGSTextureHole CGSTexture3D::hole(
 	#endif
 
 	#ifndef DISABLE_TEXTURE_HOLE_SIZE_CHECKS
-	return CGSTextureHole( address3D( _x, _y, _z, _channel ), channelSize, &modified );
+	return CGSTextureHole( address3D( _x, _y, _z, _channel ), channelSize, this );
 	#else
-	return CGSTextureHole( address3D( _x, _y, _z, _channel ), &modified );
+	return CGSTextureHole( address3D( _x, _y, _z, _channel ), this );
 	#endif
 }
 
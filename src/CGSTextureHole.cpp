@@ -18,17 +18,17 @@
 #include "CGSUtility.h"
 
 #ifndef DISABLE_TEXTURE_HOLE_SIZE_CHECKS
-CGSTextureHole::CGSTextureHole( uint8_t* const& address, const uint8_t& _channelSize, bool* _textureModifiedFlag )
+CGSTextureHole::CGSTextureHole( uint8_t* const& address, const uint8_t& _channelSize, CGSTexture* const& _texture )
 {
 	addressInTexture = address;
 	channelSize = _channelSize;
-	textureModifiedFlag = _textureModifiedFlag;
+	texture = _texture;
 }
 #else
-CGSTextureHole::CGSTextureHole( uint8_t* const& address, bool* _textureModifiedFlag )
+CGSTextureHole::CGSTextureHole( uint8_t* const& address, CGSTexture* const& _texture )
 {
 	addressInTexture = address;
-	textureModifiedFlag = _textureModifiedFlag;
+	texture = _texture;
 }
 #endif
 
@@ -58,7 +58,7 @@ void CGSTextureHole::write16F( const float& d )
 	
 	*((uint16_t*)addressInTexture) = floatToHalf( d );
 	
-	*textureModifiedFlag = true;
+	texture->setModified( );
 }
 
 float CGSTextureHole::read16F( )
@@ -74,7 +74,7 @@ void CGSTextureHole::write32F( const float& d )
 	
 	*((float*)addressInTexture) = d;
 	
-	*textureModifiedFlag = true;
+	texture->setModified( );
 }
 
 float CGSTextureHole::read32F( )
@@ -92,7 +92,7 @@ void CGSTextureHole::write8_UNORM( const float& d )
 	
 	*((uint8_t*)addressInTexture) = floatToUNORM8( d );
 	
-	*textureModifiedFlag = true;
+	texture->setModified( );
 }
 
 float CGSTextureHole::read8_UNORM( )
@@ -108,7 +108,7 @@ void CGSTextureHole::write16_UNORM( const float& d )
 	
 	*((uint16_t*)addressInTexture) = floatToUNORM16( d );
 	
-	*textureModifiedFlag = true;
+	texture->setModified( );
 }
 
 float CGSTextureHole::read16_UNORM( )
@@ -126,7 +126,7 @@ void CGSTextureHole::write8_SNORM( const float& d )
 	
 	*((int8_t*)addressInTexture) = floatToSNORM8( d );
 	
-	*textureModifiedFlag = true;
+	texture->setModified( );
 }
 
 float CGSTextureHole::read8_SNORM( )
@@ -142,7 +142,7 @@ void CGSTextureHole::write16_SNORM( const float& d )
 	
 	*((int16_t*)addressInTexture) = floatToSNORM16( d );
 	
-	*textureModifiedFlag = true;
+	texture->setModified( );
 }
 
 float CGSTextureHole::read16_SNORM( )
@@ -160,7 +160,7 @@ void CGSTextureHole::write8UI( const uint8_t& d )
 	
 	*((uint8_t*)addressInTexture) = d;
 	
-	*textureModifiedFlag = true;
+	texture->setModified( );
 }
 
 uint8_t CGSTextureHole::read8UI( )
@@ -176,7 +176,7 @@ void CGSTextureHole::write16UI( const uint16_t& d )
 	
 	*((uint16_t*)addressInTexture) = d;
 	
-	*textureModifiedFlag = true;
+	texture->setModified( );
 }
 
 uint16_t CGSTextureHole::read16UI( )
@@ -192,7 +192,7 @@ void CGSTextureHole::write32UI( const uint32_t& d )
 	
 	*((uint32_t*)addressInTexture) = d;
 	
-	*textureModifiedFlag = true;
+	texture->setModified( );
 }
 
 uint32_t CGSTextureHole::read32UI( )
@@ -210,7 +210,7 @@ void CGSTextureHole::write8I( const int8_t& d )
 	
 	*((int8_t*)addressInTexture) = d;
 	
-	*textureModifiedFlag = true;
+	texture->setModified( );
 }
 
 int8_t CGSTextureHole::read8I( )
@@ -226,7 +226,7 @@ void CGSTextureHole::write16I( const int16_t& d )
 	
 	*((int16_t*)addressInTexture) = d;
 	
-	*textureModifiedFlag = true;
+	texture->setModified( );
 }
 
 int16_t CGSTextureHole::read16I( )
@@ -242,7 +242,7 @@ void CGSTextureHole::write32I( const int32_t& d )
 	
 	*((int32_t*)addressInTexture) = d;
 	
-	*textureModifiedFlag = true;
+	texture->setModified( );
 }
 
 int32_t CGSTextureHole::read32I( )
@@ -0,0 +1,99 @@
+/*	Copyright (c) 2015-2016 William Kappler
+
+	Permission to use, copy, modify, and/or distribute this software for any
+	purpose with or without fee is hereby granted, provided that the above
+	copyright notice and this permission notice appear in all copies.
+
+	THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+	REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+	AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+	INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+	LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+	OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+	PERFORMANCE OF THIS SOFTWARE. */
+
+// CGSVertexLayout is all templates, so there is nothing to compile here but
+// checks of it, which fail the build rather than a draw.
+#include "CGSVertexLayout.h"
+
+namespace
+{
+
+// Position, UVs and color, in ascending index order.
+typedef CGSVertexLayout<
+		CGSVertexAttribute< 0, vec3 >,
+		CGSVertexAttribute< 1, vec2 >,
+		CGSVertexAttribute< 2, CGSUNorm8x4 > > SpriteLayout;
+
+struct SpriteVertex
+{
+	vec3 position;
+	vec2 uv;
+	CGSUNorm8x4 color;
+};
+
+static_assert( SpriteLayout::size( ) == 3, "A layout counts its attributes" );
+static_assert( SpriteLayout::getOffset( 0 ) == 0, "The first attribute starts a vertex" );
+static_assert( SpriteLayout::getOffset( 1 ) == 12, "Attributes are packed" );
+static_assert( SpriteLayout::getOffset( 2 ) == 20, "Attributes are packed" );
+static_assert( SpriteLayout::getStride( ) == 24, "The stride is the size of every attribute" );
+static_assert( SpriteLayout::getOffset( SpriteLayout::size( ) ) == SpriteLayout::getStride( ),
+		"The offset past the last attribute is the stride" );
+static_assert( sizeof( SpriteVertex ) == SpriteLayout::getStride( ),
+		"A struct of the attributes in order matches the stream" );
+static_assert( SpriteLayout::isOrdered( ), "Ascending indexes are in stream order" );
+
+// A normalized color is four bytes, read as four components of one byte.
+static_assert( sizeof( CGSUNorm8x4 ) == 4, "CGSUNorm8x4 is one byte a channel" );
+static_assert( CGSVertexElement< CGSUNorm8x4 >::TYPE == GL_UNSIGNED_BYTE
+		&& CGSVertexElement< CGSUNorm8x4 >::ELEMENTS == 4
+		&& CGSVertexElement< CGSUNorm8x4 >::NORMALIZED,
+		"CGSUNorm8x4 is four normalized unsigned bytes" );
+static_assert( !CGSVertexElement< uint8_t >::NORMALIZED, "Plain integers are not normalized" );
+static_assert( isVertexElementPacked< CGSUNorm8x4 >( ) && isVertexElementPacked< dvec3 >( ),
+		"Supported types have no padding" );
+
+// A type whose size is not that of its elements, as a struct the compiler pads
+// would be. CGSVertexAttribute refuses it.
+struct PaddedElement
+{
+	uint8_t value;
+	uint32_t padding;
+};
+
+}
+
+template< > struct CGSVertexElement< PaddedElement > : _CGSVertexElementInfo< uint8_t, GL_UNSIGNED_BYTE, 1 > { };
+
+namespace
+{
+
+static_assert( !isVertexElementPacked< PaddedElement >( ), "Padding in an attribute type is found" );
+
+// Out of order, and repeating an index. The stream would not match either.
+typedef CGSVertexLayout<
+		CGSVertexAttribute< 1, vec2 >,
+		CGSVertexAttribute< 0, vec3 > > SwappedLayout;
+typedef CGSVertexLayout<
+		CGSVertexAttribute< 0, vec3 >,
+		CGSVertexAttribute< 0, vec2 > > RepeatedLayout;
+typedef CGSVertexLayout< CGSVertexAttribute< 3, float > > SingleLayout;
+
+static_assert( !SwappedLayout::isOrdered( ), "Descending indexes are out of stream order" );
+static_assert( !RepeatedLayout::isOrdered( ), "A repeated index is out of stream order" );
+static_assert( SingleLayout::isOrdered( ) && SingleLayout::getStride( ) == 4,
+		"One attribute is a layout of its own" );
+
+// CGSMesh::writeVertices( ) writes only with the layout the mesh was created
+// with, as told by its tag. The same attributes are the same layout.
+static_assert( SpriteLayout::_getTag( ) != SwappedLayout::_getTag( ),
+		"Layouts of the same attributes in another order have their own tags" );
+static_assert( SpriteLayout::_getTag( ) != SingleLayout::_getTag( ),
+		"Different layouts have their own tags" );
+static_assert( SpriteLayout::_getTag( ) == CGSVertexLayout<
+				CGSVertexAttribute< 0, vec3 >,
+				CGSVertexAttribute< 1, vec2 >,
+				CGSVertexAttribute< 2, CGSUNorm8x4 > >::_getTag( ),
+		"Layouts of the same attributes share a tag" );
+
+}